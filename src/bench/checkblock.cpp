@@ -7,11 +7,13 @@
 #include <chainparams.h>
 #include <common/args.h>
 #include <consensus/validation.h>
+#include <crypto/sha256.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <tinyformat.h>
 #include <util/chaintype.h>
 #include <validation.h>
 
@@ -39,6 +41,14 @@ static void DeserializeBlockTest(benchmark::Bench& bench)
     });
 }
 
+static void DeserializeBlockMultiBufferTest(benchmark::Bench& bench)
+{
+    // Hash the txids in the 8-way AVX2 lanes even where SHA-NI is available.
+    bench.name(strprintf("%s using the '%s' SHA256 implementation", __func__, SHA256AutoDetect(sha256_implementation::USE_SSE4_AND_AVX2)));
+    DeserializeBlockTest(bench);
+    SHA256AutoDetect();
+}
+
 static void DeserializeAndCheckBlockTest(benchmark::Bench& bench)
 {
     DataStream stream(benchmark::data::block413567);
@@ -61,4 +71,5 @@ static void DeserializeAndCheckBlockTest(benchmark::Bench& bench)
 }
 
 BENCHMARK(DeserializeBlockTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(DeserializeBlockMultiBufferTest, benchmark::PriorityLevel::HIGH);
 BENCHMARK(DeserializeAndCheckBlockTest, benchmark::PriorityLevel::HIGH);
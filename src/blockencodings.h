@@ -63,9 +63,19 @@ public:
     explicit BlockTransactions(const BlockTransactionsRequest& req) :
         blockhash(req.blockhash), txn(req.indexes.size()) {}
 
-    SERIALIZE_METHODS(BlockTransactions, obj)
+    template <typename Stream>
+    void Serialize(Stream& s) const
     {
-        READWRITE(obj.blockhash, TX_WITH_WITNESS(Using<VectorFormatter<TransactionCompression>>(obj.txn)));
+        s << blockhash << TX_WITH_WITNESS(Using<VectorFormatter<TransactionCompression>>(txn));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        // Compute the txids and wtxids of all missing transactions in one batch.
+        std::vector<CMutableTransaction> txs;
+        s >> blockhash >> TX_WITH_WITNESS(txs);
+        txn = MakeTransactionRefs(std::move(txs));
     }
 };
 
@@ -13,6 +13,8 @@
 #include <algorithm>
 #include <iterator>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 
 /**
@@ -141,14 +143,14 @@ public:
     Mutex m_control_mutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num)
+    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num, std::string_view description = "Script verification", std::string_view thread_prefix = "scriptch")
         : nBatchSize(batch_size)
     {
-        LogInfo("Script verification uses %d additional threads", worker_threads_num);
+        LogInfo("%s uses %d additional threads", description, worker_threads_num);
         m_worker_threads.reserve(worker_threads_num);
         for (int n = 0; n < worker_threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
+            m_worker_threads.emplace_back([this, n, prefix = std::string{thread_prefix}]() {
+                util::ThreadRename(strprintf("%s.%i", prefix, n));
                 Loop(false /* worker thread */);
             });
         }
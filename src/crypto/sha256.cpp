@@ -37,6 +37,7 @@ void Transform_4way(unsigned char* out, const unsigned char* in);
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_x86_shani
@@ -482,6 +483,8 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
+TransformMultiType TransformMulti_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -565,6 +568,20 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformMulti_8way, if available: lane i continues from state i with block i.
+    if (TransformMulti_8way) {
+        uint32_t state[64];
+        const unsigned char* chunks[8];
+        for (int i = 0; i < 8; ++i) {
+            std::copy(result[i], result[i] + 8, state + 8 * i);
+            chunks[i] = data + 1 + 64 * i;
+        }
+        TransformMulti_8way(state, chunks);
+        for (int i = 0; i < 8; ++i) {
+            if (!std::equal(state + 8 * i, state + 8 * i + 8, result[i + 1])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -590,6 +607,7 @@ std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implem
     TransformD64_2way = nullptr;
     TransformD64_4way = nullptr;
     TransformD64_8way = nullptr;
+    TransformMulti_8way = nullptr;
 
 #if !defined(DISABLE_OPTIMIZED_SHA256)
 #if defined(HAVE_GETCPUID)
@@ -646,6 +664,7 @@ std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implem
 #if defined(ENABLE_AVX2)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256d64_avx2::TransformMulti_8way;
         ret += ";avx2(8way)";
     }
 #endif
@@ -779,3 +798,124 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+namespace {
+/** One message being double-SHA256 hashed in a lane of the multi-buffer transform. */
+class HashLane
+{
+    uint32_t* m_state{nullptr};
+    const unsigned char* m_data{nullptr}; //!< Remaining whole 64-byte blocks of the message
+    size_t m_blocks{0};
+    unsigned char m_tail[128];            //!< Message tail plus padding, then the padded first digest
+    size_t m_tail_blocks{0};
+    size_t m_tail_pos{0};
+    bool m_second{false};
+    unsigned char* m_out{nullptr};
+
+    void Digest(unsigned char* out) const
+    {
+        for (int i = 0; i < 8; ++i) WriteBE32(out + 4 * i, m_state[i]);
+    }
+
+public:
+    void Start(uint32_t* state, std::span<const unsigned char> in, unsigned char* out)
+    {
+        m_state = state;
+        sha256::Initialize(m_state);
+        m_data = in.data();
+        m_blocks = in.size() / 64;
+        const size_t rem = in.size() % 64;
+        m_tail_blocks = rem + 9 > 64 ? 2 : 1;
+        if (rem) memcpy(m_tail, in.data() + 64 * m_blocks, rem);
+        memset(m_tail + rem, 0, 64 * m_tail_blocks - rem);
+        m_tail[rem] = 0x80;
+        WriteBE64(m_tail + 64 * m_tail_blocks - 8, uint64_t(in.size()) << 3);
+        m_tail_pos = 0;
+        m_second = false;
+        m_out = out;
+    }
+
+    /** Return the next block to compress into the lane's state, or nullptr once the result was written. */
+    const unsigned char* Next()
+    {
+        if (m_blocks) {
+            --m_blocks;
+            const unsigned char* ret = m_data;
+            m_data += 64;
+            return ret;
+        }
+        if (m_tail_pos < m_tail_blocks) return m_tail + 64 * m_tail_pos++;
+        if (!m_second) {
+            // The first hash is complete: its digest is a single padded block.
+            Digest(m_tail);
+            memset(m_tail + 32, 0, 32);
+            m_tail[32] = 0x80;
+            WriteBE64(m_tail + 56, 256);
+            sha256::Initialize(m_state);
+            m_tail_blocks = 1;
+            m_tail_pos = 1;
+            m_second = true;
+            return m_tail;
+        }
+        Digest(m_out);
+        return nullptr;
+    }
+};
+} // namespace
+
+void SHA256DMany(unsigned char* out, std::span<const std::span<const unsigned char>> inputs)
+{
+    size_t next = 0;
+    if (TransformMulti_8way && inputs.size() >= 4) {
+        // Every lane takes a new message as soon as its previous one is done, so
+        // messages of different lengths keep all lanes busy until the queue runs out.
+        static const unsigned char idle_block[64] = {};
+        uint32_t state[64] = {};
+        HashLane lanes[8];
+        const unsigned char* chunks[8];
+        size_t active = 0;
+        for (int i = 0; i < 8; ++i) {
+            chunks[i] = nullptr;
+            if (next < inputs.size()) {
+                lanes[i].Start(state + 8 * i, inputs[next], out + 32 * next);
+                chunks[i] = lanes[i].Next();
+                ++next;
+                ++active;
+            }
+        }
+        while (active >= 4) {
+            for (int i = 0; i < 8; ++i) {
+                if (!chunks[i]) chunks[i] = idle_block;
+            }
+            TransformMulti_8way(state, chunks);
+            for (int i = 0; i < 8; ++i) {
+                if (chunks[i] == idle_block) {
+                    chunks[i] = nullptr;
+                    continue;
+                }
+                chunks[i] = lanes[i].Next();
+                if (!chunks[i]) {
+                    if (next < inputs.size()) {
+                        lanes[i].Start(state + 8 * i, inputs[next], out + 32 * next);
+                        chunks[i] = lanes[i].Next();
+                        ++next;
+                    } else {
+                        --active;
+                    }
+                }
+            }
+        }
+        // Too few messages left to fill the lanes; finish them one at a time.
+        for (int i = 0; i < 8; ++i) {
+            while (chunks[i]) {
+                Transform(state + 8 * i, chunks[i], 1);
+                chunks[i] = lanes[i].Next();
+            }
+        }
+    }
+    for (; next < inputs.size(); ++next) {
+        unsigned char buf[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(inputs[next].data(), inputs[next].size()).Finalize(buf);
+        CSHA256().Write(buf, sizeof(buf)).Finalize(out + 32 * next);
+    }
+}
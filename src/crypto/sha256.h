@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <span>
 #include <string>
 
 /** A hasher class for SHA-256. */
@@ -50,4 +51,12 @@ std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implem
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the double-SHA256's of multiple messages of arbitrary length.
+ *  When a multi-buffer implementation is available, the messages are hashed
+ *  side by side in its lanes.
+ *  output:  pointer to an inputs.size()*32 byte output buffer
+ *  inputs:  the messages to hash.
+ */
+void SHA256DMany(unsigned char* output, std::span<const std::span<const unsigned char>> inputs);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -324,6 +324,64 @@ void Transform_8way(unsigned char* out, const unsigned char* in)
     Write8(out, 28, Add(h, K(0x5be0cd19ul)));
 }
 
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks)
+{
+    static constexpr uint32_t k[64] = {
+        0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+        0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+        0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+        0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+        0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+        0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+        0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+        0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul};
+
+    // Lane i keeps its state in s[8 * i] .. s[8 * i + 7] and element i of each vector.
+    __m256i st[8];
+    for (int j = 0; j < 8; ++j) {
+        st[j] = _mm256_set_epi32(s[56 + j], s[48 + j], s[40 + j], s[32 + j], s[24 + j], s[16 + j], s[8 + j], s[j]);
+    }
+    __m256i w[16];
+    for (int j = 0; j < 16; ++j) {
+        w[j] = _mm256_set_epi32(
+            ReadBE32(chunks[7] + 4 * j), ReadBE32(chunks[6] + 4 * j), ReadBE32(chunks[5] + 4 * j), ReadBE32(chunks[4] + 4 * j),
+            ReadBE32(chunks[3] + 4 * j), ReadBE32(chunks[2] + 4 * j), ReadBE32(chunks[1] + 4 * j), ReadBE32(chunks[0] + 4 * j));
+    }
+
+    __m256i a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], f = st[5], g = st[6], h = st[7];
+    for (int r = 0; r < 64; r += 8) {
+        if (r >= 16) {
+            for (int j = 0; j < 8; ++j) {
+                const int i = (r + j) & 15;
+                Inc(w[i], sigma1(w[(i + 14) & 15]), w[(i + 9) & 15], sigma0(w[(i + 1) & 15]));
+            }
+        }
+        Round(a, b, c, d, e, f, g, h, Add(K(k[r + 0]), w[(r + 0) & 15]));
+        Round(h, a, b, c, d, e, f, g, Add(K(k[r + 1]), w[(r + 1) & 15]));
+        Round(g, h, a, b, c, d, e, f, Add(K(k[r + 2]), w[(r + 2) & 15]));
+        Round(f, g, h, a, b, c, d, e, Add(K(k[r + 3]), w[(r + 3) & 15]));
+        Round(e, f, g, h, a, b, c, d, Add(K(k[r + 4]), w[(r + 4) & 15]));
+        Round(d, e, f, g, h, a, b, c, Add(K(k[r + 5]), w[(r + 5) & 15]));
+        Round(c, d, e, f, g, h, a, b, Add(K(k[r + 6]), w[(r + 6) & 15]));
+        Round(b, c, d, e, f, g, h, a, Add(K(k[r + 7]), w[(r + 7) & 15]));
+    }
+
+    alignas(32) uint32_t out[8][8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out[0]), Add(a, st[0]));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out[1]), Add(b, st[1]));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out[2]), Add(c, st[2]));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out[3]), Add(d, st[3]));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out[4]), Add(e, st[4]));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out[5]), Add(f, st[5]));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out[6]), Add(g, st[6]));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out[7]), Add(h, st[7]));
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            s[8 * i + j] = out[j][i];
+        }
+    }
+}
+
 }
 
 #endif
@@ -4,6 +4,8 @@
 
 #include <dbwrapper.h>
 
+#include <bitcoin-build-config.h> // IWYU pragma: keep
+
 #include <logging.h>
 #include <random.h>
 #include <serialize.h>
@@ -13,8 +15,11 @@
 #include <util/fs_helpers.h>
 #include <util/obfuscation.h>
 #include <util/strencodings.h>
+#include <util/thread.h>
+#include <util/time.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdarg>
 #include <cstdint>
@@ -31,10 +36,21 @@
 #include <leveldb/write_batch.h>
 #include <memory>
 #include <optional>
+#include <sstream>
 #include <utility>
 
+#ifdef HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 static auto CharCast(const std::byte* data) { return reinterpret_cast<const char*>(data); }
 
+// Level-0 file counts at which LevelDB slows down and stops writes
+// (kL0_SlowdownWritesTrigger and kL0_StopWritesTrigger in db/dbformat.h).
+static constexpr int LEVELDB_L0_SLOWDOWN_WRITES_TRIGGER{8};
+static constexpr int LEVELDB_L0_STOP_WRITES_TRIGGER{12};
+
 bool DestroyDB(const std::string& path_str)
 {
     return leveldb::DestroyDB(path_str, {}).ok();
@@ -135,6 +151,84 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
+//! How far ahead of the current read position table files are read during a scan.
+static constexpr uint64_t SCAN_READAHEAD_BYTES{4 << 20};
+
+//! Number of scan iterator operations in progress on this thread.
+static thread_local int g_scan_depth{0};
+
+/** Marks table file reads on this thread as part of a sequential scan. */
+class ScanScope
+{
+public:
+    explicit ScanScope(bool scan) : m_scan{scan} { if (m_scan) ++g_scan_depth; }
+    ~ScanScope() { if (m_scan) --g_scan_depth; }
+    ScanScope(const ScanScope&) = delete;
+    ScanScope& operator=(const ScanScope&) = delete;
+
+private:
+    const bool m_scan;
+};
+
+/** Ask the OS to read a range of a file into the page cache in the background. */
+static void AdviseWillNeed(const std::string& fname, uint64_t offset, uint64_t length)
+{
+#ifdef HAVE_POSIX_FADVISE
+    // Table files are usually mmap'ed without keeping a descriptor open, so
+    // use a short-lived one. The advice applies to the shared page cache.
+    const int fd{::open(fname.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd < 0) return;
+    ::posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+    ::close(fd);
+#endif
+}
+
+/** Table file that reads ahead when it is accessed from a scan iterator. */
+class ReadaheadRandomAccessFile : public leveldb::RandomAccessFile
+{
+public:
+    ReadaheadRandomAccessFile(std::string fname, leveldb::RandomAccessFile* file)
+        : m_fname{std::move(fname)}, m_file{file} {}
+
+    leveldb::Status Read(uint64_t offset, size_t n, leveldb::Slice* result, char* scratch) const override
+    {
+        if (g_scan_depth > 0) {
+            const uint64_t end{offset + n};
+            const uint64_t ahead{m_readahead_end.load(std::memory_order_relaxed)};
+            // Extend the window once half of it is consumed, and start over
+            // after a seek that left it.
+            if (ahead < end + SCAN_READAHEAD_BYTES / 2 || ahead > end + SCAN_READAHEAD_BYTES) {
+                const uint64_t from{ahead >= end && ahead <= end + SCAN_READAHEAD_BYTES ? ahead : end};
+                AdviseWillNeed(m_fname, from, end + SCAN_READAHEAD_BYTES - from);
+                m_readahead_end.store(end + SCAN_READAHEAD_BYTES, std::memory_order_relaxed);
+            }
+        }
+        return m_file->Read(offset, n, result, scratch);
+    }
+
+    std::string GetName() const override { return m_file->GetName(); }
+
+private:
+    const std::string m_fname;
+    const std::unique_ptr<leveldb::RandomAccessFile> m_file;
+    mutable std::atomic<uint64_t> m_readahead_end{0};
+};
+
+/** Environment whose table files read ahead for scan iterators. */
+class ReadaheadEnv : public leveldb::EnvWrapper
+{
+public:
+    ReadaheadEnv() : leveldb::EnvWrapper{leveldb::Env::Default()} {}
+
+    leveldb::Status NewRandomAccessFile(const std::string& fname, leveldb::RandomAccessFile** result) override
+    {
+        leveldb::RandomAccessFile* file{nullptr};
+        leveldb::Status status{target()->NewRandomAccessFile(fname, &file)};
+        *result = status.ok() ? new ReadaheadRandomAccessFile{fname, file} : nullptr;
+        return status;
+    }
+};
+
 static leveldb::Options GetOptions(size_t nCacheSize)
 {
     leveldb::Options options;
@@ -214,7 +308,8 @@ struct LevelDBContext {
 };
 
 CDBWrapper::CDBWrapper(const DBParams& params)
-    : m_db_context{std::make_unique<LevelDBContext>()}, m_name{fs::PathToString(params.path.stem())}, m_path{params.path}, m_is_memory{params.memory_only}
+    : m_db_context{std::make_unique<LevelDBContext>()}, m_name{fs::PathToString(params.path.stem())}, m_path{params.path}, m_is_memory{params.memory_only},
+      m_compaction_budget{params.options.compaction_budget}
 {
     DBContext().penv = nullptr;
     DBContext().readoptions.verify_checksums = true;
@@ -227,6 +322,8 @@ CDBWrapper::CDBWrapper(const DBParams& params)
         DBContext().penv = leveldb::NewMemEnv(leveldb::Env::Default());
         DBContext().options.env = DBContext().penv;
     } else {
+        DBContext().penv = new ReadaheadEnv();
+        DBContext().options.env = DBContext().penv;
         if (params.wipe_data) {
             LogInfo("Wiping LevelDB in %s", fs::PathToString(params.path));
             leveldb::Status result = leveldb::DestroyDB(fs::PathToString(params.path), DBContext().options);
@@ -262,6 +359,13 @@ CDBWrapper::CDBWrapper(const DBParams& params)
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(m_compaction_mutex);
+        m_stop_compaction = true;
+    }
+    m_compaction_cv.notify_all();
+    if (m_compaction_thread.joinable()) m_compaction_thread.join();
+
     delete DBContext().pdb;
     DBContext().pdb = nullptr;
     delete DBContext().options.filter_policy;
@@ -281,7 +385,9 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
+    ++m_writes_in_progress;
     leveldb::Status status = DBContext().pdb->Write(fSync ? DBContext().syncoptions : DBContext().writeoptions, &batch.m_impl_batch->batch);
+    --m_writes_in_progress;
     HandleError(status);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
@@ -341,6 +447,133 @@ size_t CDBWrapper::EstimateSizeImpl(std::span<const std::byte> key1, std::span<c
     return size;
 }
 
+std::vector<DBLevelStats> CDBWrapper::GetLevelStats() const
+{
+    std::string stats;
+    if (!DBContext().pdb->GetProperty("leveldb.stats", &stats)) return {};
+    // Skip the three header lines, then parse one line per level:
+    // "Level Files Size(MB) Time(sec) Read(MB) Write(MB)"
+    std::istringstream lines{stats};
+    std::string line;
+    for (int i{0}; i < 3 && std::getline(lines, line); ++i) {}
+    std::vector<DBLevelStats> levels;
+    while (std::getline(lines, line)) {
+        std::istringstream fields{line};
+        DBLevelStats level;
+        if (fields >> level.level >> level.files >> level.size_mib >> level.compaction_seconds >> level.read_mib >> level.write_mib) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+int CDBWrapper::GetLevel0Files() const
+{
+    std::string files;
+    std::optional<int> parsed;
+    if (!DBContext().pdb->GetProperty("leveldb.num-files-at-level0", &files) || !(parsed = ToIntegral<int>(files))) {
+        return 0;
+    }
+    return *parsed;
+}
+
+DBWriteStall CDBWrapper::GetWriteStall() const
+{
+    const int level0_files{GetLevel0Files()};
+    if (level0_files >= LEVELDB_L0_STOP_WRITES_TRIGGER) return DBWriteStall::STOP;
+    if (level0_files >= LEVELDB_L0_SLOWDOWN_WRITES_TRIGGER) return DBWriteStall::SLOWDOWN;
+    return DBWriteStall::NONE;
+}
+
+DBCompactionStats CDBWrapper::GetCompactionStats() const
+{
+    DBCompactionStats stats;
+    {
+        LOCK(m_compaction_mutex);
+        stats.idle_compactions = m_idle_compactions;
+        stats.idle_compaction_time = m_idle_compaction_time;
+        stats.idle_compaction_bytes = m_idle_compaction_bytes;
+    }
+    stats.level0_files = GetLevel0Files();
+    stats.write_stall = GetWriteStall();
+    stats.levels = GetLevelStats();
+    return stats;
+}
+
+void CDBWrapper::RequestIdleCompactionImpl(std::span<const std::byte> prefix)
+{
+    if (m_compaction_budget == 0) return;
+    // The last slice ends where the prefix, incremented by one, begins.
+    Assume(!prefix.empty() && prefix.back() != std::byte{0xff});
+    {
+        LOCK(m_compaction_mutex);
+        if (m_stop_compaction) return;
+        if (!std::ranges::equal(m_compaction_prefix, prefix)) {
+            m_compaction_prefix.assign(prefix.begin(), prefix.end());
+            m_compaction_slice = 0;
+        }
+        m_compaction_requested = true;
+        if (!m_compaction_thread.joinable()) {
+            m_compaction_thread = std::thread(&util::TraceThread, "dbcompact", [this] { ThreadIdleCompaction(); });
+        }
+    }
+    m_compaction_cv.notify_one();
+}
+
+void CDBWrapper::ThreadIdleCompaction()
+{
+    // Bytes written by all compactions so far, as reported by LevelDB.
+    const auto compaction_writes{[this] {
+        double mib{0};
+        for (const auto& level : GetLevelStats()) mib += level.write_mib;
+        return static_cast<uint64_t>(mib * (1 << 20));
+    }};
+
+    WAIT_LOCK(m_compaction_mutex, lock);
+    while (true) {
+        m_compaction_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_compaction_mutex) { return m_stop_compaction || m_compaction_requested; });
+        if (m_stop_compaction) return;
+        m_compaction_requested = false;
+
+        while (!m_stop_compaction && m_writes_in_progress == 0 && GetLevel0Files() > 0) {
+            const int slice{m_compaction_slice};
+            m_compaction_slice = (slice + 1) % 0x100;
+            std::vector<std::byte> begin{m_compaction_prefix}, end{m_compaction_prefix};
+            begin.push_back(std::byte(slice));
+            if (slice < 0xff) {
+                end.push_back(std::byte(slice + 1));
+            } else {
+                end.back() = std::byte(std::to_integer<uint8_t>(end.back()) + 1);
+            }
+
+            uint64_t written;
+            std::chrono::microseconds elapsed;
+            {
+                REVERSE_LOCK(lock, m_compaction_mutex);
+                const uint64_t writes_before{compaction_writes()};
+                const auto start{SteadyClock::now()};
+                const leveldb::Slice slBegin(CharCast(begin.data()), begin.size());
+                const leveldb::Slice slEnd(CharCast(end.data()), end.size());
+                DBContext().pdb->CompactRange(&slBegin, &slEnd);
+                elapsed = std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start);
+                // LevelDB reports whole MiB, so fall back to the size of the
+                // slice for small compactions.
+                const uint64_t writes_after{compaction_writes()};
+                written = std::max<uint64_t>(writes_after > writes_before ? writes_after - writes_before : 0, EstimateSizeImpl(begin, end));
+            }
+            ++m_idle_compactions;
+            m_idle_compaction_time += elapsed;
+            m_idle_compaction_bytes += written;
+            LogDebug(BCLog::LEVELDB, "Idle compaction of %s slice %d wrote about %d bytes in %dms\n",
+                     m_name, slice, written, Ticks<std::chrono::milliseconds>(elapsed));
+
+            // Stay within the I/O budget before compacting the next slice.
+            const auto pause{std::chrono::microseconds{written * 1'000'000 / m_compaction_budget}};
+            m_compaction_cv.wait_for(lock, pause, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_compaction_mutex) { return m_stop_compaction; });
+        }
+    }
+}
+
 bool CDBWrapper::IsEmpty()
 {
     std::unique_ptr<CDBIterator> it(NewIterator());
@@ -354,17 +587,24 @@ struct CDBIterator::IteratorImpl {
     explicit IteratorImpl(leveldb::Iterator* _iter) : iter{_iter} {}
 };
 
-CDBIterator::CDBIterator(const CDBWrapper& _parent, std::unique_ptr<IteratorImpl> _piter) : parent(_parent),
-                                                                                            m_impl_iter(std::move(_piter)) {}
+CDBIterator::CDBIterator(const CDBWrapper& _parent, std::unique_ptr<IteratorImpl> _piter, bool scan) : parent(_parent),
+                                                                                                       m_impl_iter(std::move(_piter)),
+                                                                                                       m_scan{scan} {}
 
 CDBIterator* CDBWrapper::NewIterator()
 {
     return new CDBIterator{*this, std::make_unique<CDBIterator::IteratorImpl>(DBContext().pdb->NewIterator(DBContext().iteroptions))};
 }
 
+CDBIterator* CDBWrapper::NewScanIterator()
+{
+    return new CDBIterator{*this, std::make_unique<CDBIterator::IteratorImpl>(DBContext().pdb->NewIterator(DBContext().iteroptions)), /*scan=*/true};
+}
+
 void CDBIterator::SeekImpl(std::span<const std::byte> key)
 {
     leveldb::Slice slKey(CharCast(key.data()), key.size());
+    ScanScope scope{m_scan};
     m_impl_iter->iter->Seek(slKey);
 }
 
@@ -380,8 +620,16 @@ std::span<const std::byte> CDBIterator::GetValueImpl() const
 
 CDBIterator::~CDBIterator() = default;
 bool CDBIterator::Valid() const { return m_impl_iter->iter->Valid(); }
-void CDBIterator::SeekToFirst() { m_impl_iter->iter->SeekToFirst(); }
-void CDBIterator::Next() { m_impl_iter->iter->Next(); }
+void CDBIterator::SeekToFirst()
+{
+    ScanScope scope{m_scan};
+    m_impl_iter->iter->SeekToFirst();
+}
+void CDBIterator::Next()
+{
+    ScanScope scope{m_scan};
+    m_impl_iter->iter->Next();
+}
 
 namespace dbwrapper_private {
 
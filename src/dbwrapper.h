@@ -9,24 +9,65 @@
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <sync.h>
 #include <util/check.h>
 #include <util/fs.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 static const size_t DBWRAPPER_MAX_FILE_SIZE = 32 << 20; // 32 MiB
+//! -dbcompactionbudget default, in MiB per second
+static constexpr int64_t DEFAULT_DB_COMPACTION_BUDGET{32};
 
 //! User-controlled performance and debug options.
 struct DBOptions {
     //! Compact database on startup.
     bool force_compact = false;
+    //! I/O budget of idle compactions, in bytes per second. 0 disables them.
+    uint64_t compaction_budget = uint64_t{DEFAULT_DB_COMPACTION_BUDGET} << 20;
+};
+
+//! Whether LevelDB currently delays or blocks writes because level 0 holds too many table files.
+enum class DBWriteStall {
+    NONE,
+    SLOWDOWN, //!< each write is delayed by 1ms
+    STOP,     //!< writes wait for a compaction to finish
+};
+
+//! Compaction statistics LevelDB keeps for one level.
+struct DBLevelStats {
+    int level;
+    int files;
+    double size_mib;
+    double compaction_seconds;
+    double read_mib;
+    double write_mib;
+};
+
+struct DBCompactionStats {
+    //! Range compactions run by the idle compaction scheduler.
+    uint64_t idle_compactions{0};
+    //! Time spent in them.
+    std::chrono::microseconds idle_compaction_time{0};
+    //! Bytes they wrote, as reported by LevelDB.
+    uint64_t idle_compaction_bytes{0};
+    int level0_files{0};
+    DBWriteStall write_stall{DBWriteStall::NONE};
+    //! Per-level statistics, including LevelDB's own background compactions.
+    std::vector<DBLevelStats> levels;
 };
 
 //! Application-specific storage settings.
@@ -124,6 +165,8 @@ public:
 private:
     const CDBWrapper &parent;
     const std::unique_ptr<IteratorImpl> m_impl_iter;
+    //! whether table file reads made through this iterator are read ahead
+    const bool m_scan;
 
     void SeekImpl(std::span<const std::byte> key);
     std::span<const std::byte> GetKeyImpl() const;
@@ -134,8 +177,9 @@ public:
     /**
      * @param[in] _parent          Parent CDBWrapper instance.
      * @param[in] _piter           The original leveldb iterator.
+     * @param[in] scan             Read ahead in the table files while iterating.
      */
-    CDBIterator(const CDBWrapper& _parent, std::unique_ptr<IteratorImpl> _piter);
+    CDBIterator(const CDBWrapper& _parent, std::unique_ptr<IteratorImpl> _piter, bool scan = false);
     ~CDBIterator();
 
     bool Valid() const;
@@ -200,8 +244,31 @@ private:
     std::optional<std::string> ReadImpl(std::span<const std::byte> key) const;
     bool ExistsImpl(std::span<const std::byte> key) const;
     size_t EstimateSizeImpl(std::span<const std::byte> key1, std::span<const std::byte> key2) const;
+    void RequestIdleCompactionImpl(std::span<const std::byte> prefix) EXCLUSIVE_LOCKS_REQUIRED(!m_compaction_mutex);
     auto& DBContext() const LIFETIMEBOUND { return *Assert(m_db_context); }
 
+    //! I/O budget of idle compactions, in bytes per second.
+    const uint64_t m_compaction_budget;
+    //! Number of WriteBatch() calls in progress; idle compactions wait for them.
+    std::atomic<int> m_writes_in_progress{0};
+
+    mutable Mutex m_compaction_mutex;
+    std::condition_variable m_compaction_cv;
+    std::thread m_compaction_thread;
+    bool m_compaction_requested GUARDED_BY(m_compaction_mutex){false};
+    bool m_stop_compaction GUARDED_BY(m_compaction_mutex){false};
+    //! Serialized key prefix whose range idle compactions cover.
+    std::vector<std::byte> m_compaction_prefix GUARDED_BY(m_compaction_mutex);
+    //! Next slice of that range, by the key byte following the prefix.
+    int m_compaction_slice GUARDED_BY(m_compaction_mutex){0};
+    uint64_t m_idle_compactions GUARDED_BY(m_compaction_mutex){0};
+    std::chrono::microseconds m_idle_compaction_time GUARDED_BY(m_compaction_mutex){0};
+    uint64_t m_idle_compaction_bytes GUARDED_BY(m_compaction_mutex){0};
+
+    void ThreadIdleCompaction() EXCLUSIVE_LOCKS_REQUIRED(!m_compaction_mutex);
+    std::vector<DBLevelStats> GetLevelStats() const;
+    int GetLevel0Files() const;
+
 public:
     CDBWrapper(const DBParams& params);
     ~CDBWrapper();
@@ -269,6 +336,34 @@ public:
 
     CDBIterator* NewIterator();
 
+    /**
+     * Return an iterator for a sequential scan over a large part of the
+     * database. Like NewIterator(), its reads do not fill the block cache, so
+     * the scan does not evict entries that point lookups depend on. In
+     * addition, the table files it reads from are read ahead by the OS as the
+     * scan advances.
+     */
+    CDBIterator* NewScanIterator();
+
+    /**
+     * Ask for an out-of-band compaction while the caller is idle, e.g.
+     * between blocks. As long as level 0 holds table files, a background
+     * thread compacts the range of keys starting with prefix, one slice at a
+     * time, so that LevelDB does not have to do so while a large write
+     * waits. It stops as soon as a write starts and paces itself to stay
+     * within the configured I/O budget.
+     */
+    template <typename K>
+    void RequestIdleCompaction(const K& prefix) EXCLUSIVE_LOCKS_REQUIRED(!m_compaction_mutex)
+    {
+        DataStream ssKey{};
+        ssKey << prefix;
+        RequestIdleCompactionImpl(ssKey);
+    }
+
+    DBCompactionStats GetCompactionStats() const EXCLUSIVE_LOCKS_REQUIRED(!m_compaction_mutex);
+    DBWriteStall GetWriteStall() const;
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -84,6 +84,14 @@ public:
      * @return true on success, false on failure.
      */
     bool Flush(const FlatFilePos& pos, bool finalize = false) const;
+
+    /**
+     * Truncate off extra pre-allocated bytes without committing the file to disk.
+     *
+     * @param[in] pos The first unwritten position in the file to be truncated.
+     * @return true on success, false on failure.
+     */
+    bool Truncate(const FlatFilePos& pos) const;
 };
 
 #endif // BITCOIN_FLATFILE_H
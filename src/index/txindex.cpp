@@ -8,6 +8,7 @@
 #include <common/args.h>
 #include <index/disktxpos.h>
 #include <logging.h>
+#include <node/blockcompression.h>
 #include <node/blockstorage.h>
 #include <primitives/transaction_identifier.h>
 #include <validation.h>
@@ -80,16 +81,44 @@ bool TxIndex::FindTx(const Txid& tx_hash, uint256& block_hash, CTransactionRef&
         return false;
     }
 
-    AutoFile file{m_chainstate->m_blockman.OpenBlockFile(postx, true)};
+    if (postx.nPos < node::STORAGE_HEADER_BYTES) {
+        LogError("Transaction position %s is inside the block file record header", postx.ToString());
+        return false;
+    }
+    AutoFile file{m_chainstate->m_blockman.OpenBlockFile({postx.nFile, postx.nPos - node::STORAGE_HEADER_BYTES}, true)};
     if (file.IsNull()) {
         LogError("OpenBlockFile failed");
         return false;
     }
     CBlockHeader header;
     try {
-        file >> header;
-        file.seek(postx.nTxOffset, SEEK_CUR);
-        file >> TX_WITH_WITNESS(tx);
+        MessageStartChars blk_start;
+        uint32_t blk_size;
+        file >> blk_start >> blk_size;
+        if (blk_size & node::BLOCK_COMPRESSED_FLAG) {
+            // Compressed blocks can not be seeked into; decompress the frame
+            // that follows the header just read instead.
+            const uint32_t frame_size{blk_size & ~node::BLOCK_COMPRESSED_FLAG};
+            if (frame_size > MAX_SIZE) {
+                LogError("Compressed block frame at %s is too large", postx.ToString());
+                return false;
+            }
+            std::vector<std::byte> frame(frame_size);
+            file.read(frame);
+            const auto block_data{node::DecompressBlock(frame, MAX_SIZE)};
+            if (!block_data) {
+                LogError("Malformed compressed block frame at %s", postx.ToString());
+                return false;
+            }
+            SpanReader reader{*block_data};
+            reader >> header;
+            reader.ignore(postx.nTxOffset);
+            reader >> TX_WITH_WITNESS(tx);
+        } else {
+            file >> header;
+            file.seek(postx.nTxOffset, SEEK_CUR);
+            file >> TX_WITH_WITNESS(tx);
+        }
     } catch (const std::exception& e) {
         LogError("Deserialize or I/O error - %s", e.what());
         return false;
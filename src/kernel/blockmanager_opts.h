@@ -10,12 +10,15 @@
 #include <util/fs.h>
 
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 class CChainParams;
 
 namespace kernel {
 
 static constexpr bool DEFAULT_XOR_BLOCKSDIR{true};
+static constexpr bool DEFAULT_BLOCKS_COMPRESS{false};
 
 /**
  * An options struct for `BlockManager`, more ergonomically referred to as
@@ -24,7 +27,16 @@ static constexpr bool DEFAULT_XOR_BLOCKSDIR{true};
 struct BlockManagerOpts {
     const CChainParams& chainparams;
     bool use_xor{DEFAULT_XOR_BLOCKSDIR};
+    //! Whether newly written blocks are stored as compressed frames
+    bool compress_blocks{DEFAULT_BLOCKS_COMPRESS};
     uint64_t prune_target{0};
+    //! Minimum number of most recent blocks to keep when pruning
+    uint32_t prune_keep_blocks{0};
+    //! When non-zero, undo data is pruned for blocks deeper than this, even
+    //! if their block data is kept
+    uint32_t prune_keep_undo_blocks{0};
+    //! Height ranges [first, last] whose block and undo data is never pruned
+    std::vector<std::pair<int, int>> prune_pinned_ranges{};
     bool fast_prune{false};
     const fs::path blocks_dir;
     Notifications& notifications;
@@ -0,0 +1,222 @@
+// Copyright (c) 2026-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockcompression.h>
+
+#include <crypto/common.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <util/strencodings.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string_view>
+
+namespace node {
+namespace {
+//! Shortest back-reference worth encoding.
+constexpr size_t MIN_MATCH{4};
+//! Back-references are encoded as 16-bit offsets.
+constexpr size_t MAX_OFFSET{0xffff};
+constexpr int HASH_BITS{16};
+
+/** Hex fragments that make up the preset dictionary, least common first. */
+constexpr std::array<std::string_view, 20> DICTIONARY_FRAGMENTS{
+    // Legacy input signature push and sequence numbers
+    "483045022100",
+    "4730440220",
+    "fdffffff",
+    "feffffff",
+    // P2SH and P2WSH output scripts
+    "17a914",
+    "220020",
+    // P2PKH output script
+    "1976a914",
+    "88ac",
+    // Coinbase input: null prevout and witness reserved value
+    "0000000000000000000000000000000000000000000000000000000000000000ffffffff",
+    "01200000000000000000000000000000000000000000000000000000000000000000",
+    // Witness commitment and PoL miner-tag OP_RETURN outputs
+    "266a24aa21a9ed",
+    "4d464c45584944",
+    // Transaction version plus segwit marker and flag
+    "010000000001",
+    "020000000001",
+    // Witness stacks: P2WPKH signature and pubkey, P2TR key-path signature
+    "02483045022100",
+    "024730440220",
+    "0121",
+    "0140",
+    // P2WPKH and P2TR output scripts
+    "160014",
+    "225120",
+};
+
+uint32_t HashSequence(const std::byte* p)
+{
+    return (ReadLE32(p) * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void WriteLength(std::vector<std::byte>& out, size_t len)
+{
+    while (len >= 255) {
+        out.push_back(std::byte{255});
+        len -= 255;
+    }
+    out.push_back(std::byte(len));
+}
+
+bool ReadLength(std::span<const std::byte>& in, size_t& len, size_t limit)
+{
+    while (true) {
+        if (in.empty()) return false;
+        const auto b{std::to_integer<size_t>(in.front())};
+        in = in.subspan(1);
+        len += b;
+        if (len > limit) return false;
+        if (b != 255) return true;
+    }
+}
+
+void WriteSequence(std::vector<std::byte>& out, std::span<const std::byte> literals, size_t offset, size_t match_len)
+{
+    const size_t lit_len{literals.size()};
+    const size_t extra_match{match_len ? match_len - MIN_MATCH : 0};
+    out.push_back(std::byte(((std::min<size_t>(lit_len, 15)) << 4) | std::min<size_t>(extra_match, 15)));
+    if (lit_len >= 15) WriteLength(out, lit_len - 15);
+    out.insert(out.end(), literals.begin(), literals.end());
+    // The final sequence carries literals only.
+    if (match_len == 0) return;
+    out.push_back(std::byte(offset & 0xff));
+    out.push_back(std::byte(offset >> 8));
+    if (extra_match >= 15) WriteLength(out, extra_match - 15);
+}
+
+/** Compress the bytes of window following the first dict_size bytes, which hold the dictionary. */
+std::optional<std::vector<std::byte>> CompressWindow(std::span<const std::byte> window, size_t dict_size)
+{
+    const size_t raw_size{window.size() - dict_size};
+
+    std::vector<int64_t> table(size_t{1} << HASH_BITS, -1);
+    for (size_t i{0}; i + MIN_MATCH <= dict_size; ++i) {
+        table[HashSequence(&window[i])] = i;
+    }
+
+    std::vector<std::byte> out;
+    out.resize(BLOCK_COMPRESSED_FRAME_HEADER_BYTES);
+    WriteLE32(UCharCast(out.data()), raw_size);
+
+    const size_t end{window.size()};
+    size_t anchor{dict_size};
+    size_t pos{anchor};
+    while (pos + MIN_MATCH <= end) {
+        const uint32_t h{HashSequence(&window[pos])};
+        const int64_t candidate{table[h]};
+        table[h] = pos;
+        if (candidate < 0 || pos - candidate > MAX_OFFSET ||
+            std::memcmp(&window[candidate], &window[pos], MIN_MATCH) != 0) {
+            ++pos;
+            continue;
+        }
+        size_t match_len{MIN_MATCH};
+        while (pos + match_len < end && window[candidate + match_len] == window[pos + match_len]) {
+            ++match_len;
+        }
+        WriteSequence(out, window.subspan(anchor, pos - anchor), pos - candidate, match_len);
+        // Index a few positions inside the match so that repeats of its tail are found too.
+        const size_t match_end{pos + match_len};
+        for (size_t i{pos + 1}; i + MIN_MATCH <= end && i < match_end; i += 2) {
+            table[HashSequence(&window[i])] = i;
+        }
+        pos = anchor = match_end;
+        // Give up early if the output already exceeds the input.
+        if (out.size() >= raw_size) return std::nullopt;
+    }
+    WriteSequence(out, window.subspan(anchor), 0, 0);
+
+    if (out.size() >= raw_size) return std::nullopt;
+    return out;
+}
+} // namespace
+
+std::span<const std::byte> BlockCompressionDictionary()
+{
+    static const std::vector<std::byte> dictionary{[] {
+        std::vector<std::byte> dict;
+        for (const std::string_view fragment : DICTIONARY_FRAGMENTS) {
+            const auto bytes{ParseHex<std::byte>(fragment)};
+            dict.insert(dict.end(), bytes.begin(), bytes.end());
+        }
+        return dict;
+    }()};
+    return dictionary;
+}
+
+std::optional<std::vector<std::byte>> CompressBlock(std::span<const std::byte> raw_block)
+{
+    const auto dict{BlockCompressionDictionary()};
+
+    // Matches may reach back into the dictionary, so encode over the
+    // concatenation of dictionary and input.
+    std::vector<std::byte> window;
+    window.reserve(dict.size() + raw_block.size());
+    window.insert(window.end(), dict.begin(), dict.end());
+    window.insert(window.end(), raw_block.begin(), raw_block.end());
+    return CompressWindow(window, dict.size());
+}
+
+std::optional<std::vector<std::byte>> CompressBlock(const CBlock& block)
+{
+    const auto dict{BlockCompressionDictionary()};
+
+    DataStream window;
+    window.write(dict);
+    window << TX_WITH_WITNESS(block);
+    return CompressWindow(window, dict.size());
+}
+
+std::optional<std::vector<std::byte>> DecompressBlock(std::span<const std::byte> frame, uint32_t max_size)
+{
+    if (frame.size() < BLOCK_COMPRESSED_FRAME_HEADER_BYTES) return std::nullopt;
+    const uint32_t raw_size{ReadLE32(UCharCast(frame.data()))};
+    if (raw_size > max_size) return std::nullopt;
+    frame = frame.subspan(BLOCK_COMPRESSED_FRAME_HEADER_BYTES);
+
+    const auto dict{BlockCompressionDictionary()};
+    const size_t limit{dict.size() + raw_size};
+    std::vector<std::byte> window;
+    window.reserve(limit);
+    window.insert(window.end(), dict.begin(), dict.end());
+
+    while (!frame.empty()) {
+        const auto token{std::to_integer<uint8_t>(frame.front())};
+        frame = frame.subspan(1);
+
+        size_t lit_len{size_t{token} >> 4};
+        if (lit_len == 15 && !ReadLength(frame, lit_len, raw_size)) return std::nullopt;
+        if (lit_len > frame.size() || window.size() + lit_len > limit) return std::nullopt;
+        window.insert(window.end(), frame.begin(), frame.begin() + lit_len);
+        frame = frame.subspan(lit_len);
+        if (frame.empty()) break;
+
+        if (frame.size() < 2) return std::nullopt;
+        const size_t offset{std::to_integer<size_t>(frame[0]) | (std::to_integer<size_t>(frame[1]) << 8)};
+        frame = frame.subspan(2);
+        size_t match_len{size_t{token} & 15};
+        if (match_len == 15 && !ReadLength(frame, match_len, raw_size)) return std::nullopt;
+        match_len += MIN_MATCH;
+        if (offset == 0 || offset > window.size() || window.size() + match_len > limit) return std::nullopt;
+        // Byte-wise copy, since the source may overlap the bytes being produced.
+        const size_t start{window.size() - offset};
+        for (size_t i{0}; i < match_len; ++i) {
+            window.push_back(window[start + i]);
+        }
+    }
+
+    if (window.size() != limit) return std::nullopt;
+    return std::vector<std::byte>(window.begin() + dict.size(), window.end());
+}
+
+} // namespace node
@@ -0,0 +1,72 @@
+// Copyright (c) 2026-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKCOMPRESSION_H
+#define BITCOIN_NODE_BLOCKCOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+class CBlock;
+
+namespace node {
+
+/**
+ * Bit set in the size field of a blk?????.dat record header when the record
+ * holds a compressed frame instead of a raw serialized block. Raw block sizes
+ * are bounded by MAX_SIZE, so this bit is never set for uncompressed records.
+ *
+ * A compressed frame is laid out as:
+ *   - 4 bytes: little-endian size of the uncompressed serialized block
+ *   - N bytes: LZ77 sequences encoded against BLOCK_COMPRESSION_DICTIONARY
+ *
+ * The FlatFilePos stored in the block index keeps pointing right after the
+ * 8-byte record header, exactly as for uncompressed records, so frames can be
+ * located and decompressed on demand per block.
+ */
+static constexpr uint32_t BLOCK_COMPRESSED_FLAG{0x80000000};
+
+/** Size of the uncompressed-size prefix of a compressed frame. */
+static constexpr uint32_t BLOCK_COMPRESSED_FRAME_HEADER_BYTES{sizeof(uint32_t)};
+
+/**
+ * Preset dictionary shared by the encoder and decoder. It primes the match
+ * window with byte sequences that occur in nearly every block: the coinbase
+ * prevout, common output script templates, the witness commitment, the PoL
+ * "MFLEXID" OP_RETURN tag and the usual witness signature/pubkey pushes.
+ *
+ * Changing its contents makes existing compressed block files unreadable.
+ */
+std::span<const std::byte> BlockCompressionDictionary();
+
+/**
+ * Compress a serialized block into a frame.
+ *
+ * @returns the frame, or std::nullopt when compression would not make the
+ *          record smaller (callers should then store the block raw).
+ */
+std::optional<std::vector<std::byte>> CompressBlock(std::span<const std::byte> raw_block);
+
+/**
+ * Serialize a block (with witness data) and compress it into a frame. The
+ * block is serialized directly behind the dictionary in the match window,
+ * so it is neither serialized nor copied a second time.
+ */
+std::optional<std::vector<std::byte>> CompressBlock(const CBlock& block);
+
+/**
+ * Decompress a frame produced by CompressBlock().
+ *
+ * @param[in] frame     The frame bytes as stored on disk.
+ * @param[in] max_size  Upper bound for the uncompressed size.
+ * @returns the serialized block, or std::nullopt if the frame is malformed.
+ */
+std::optional<std::vector<std::byte>> DecompressBlock(std::span<const std::byte> frame, uint32_t max_size);
+
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCKCOMPRESSION_H
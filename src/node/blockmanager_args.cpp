@@ -9,15 +9,21 @@
 #include <node/database_args.h>
 #include <tinyformat.h>
 #include <util/result.h>
+#include <util/strencodings.h>
 #include <util/translation.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
 
 namespace node {
 util::Result<void> ApplyArgsManOptions(const ArgsManager& args, BlockManager::Options& opts)
 {
     if (auto value{args.GetBoolArg("-blocksxor")}) opts.use_xor = *value;
+    if (auto value{args.GetBoolArg("-blockscompress")}) opts.compress_blocks = *value;
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg{args.GetIntArg("-prune", opts.prune_target)};
     if (nPruneArg < 0) {
@@ -33,6 +39,28 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& args, BlockManager::Op
     }
     opts.prune_target = nPruneTarget;
 
+    if (auto value{args.GetIntArg("-prunekeepblocks")}) {
+        if (*value < 0) {
+            return util::Error{_("Prunekeepblocks cannot be configured with a negative value.")};
+        }
+        opts.prune_keep_blocks = static_cast<uint32_t>(std::min<int64_t>(*value, std::numeric_limits<uint32_t>::max()));
+    }
+    if (auto value{args.GetIntArg("-prunekeepundo")}; value && *value != 0) {
+        if (*value < MIN_BLOCKS_TO_KEEP) {
+            return util::Error{strprintf(_("Prunekeepundo configured below the minimum of %d blocks."), MIN_BLOCKS_TO_KEEP)};
+        }
+        opts.prune_keep_undo_blocks = static_cast<uint32_t>(std::min<int64_t>(*value, std::numeric_limits<uint32_t>::max()));
+    }
+    for (const std::string& range : args.GetArgs("-prunepinrange")) {
+        const auto sep{range.find('-')};
+        const auto first{sep == std::string::npos ? std::nullopt : ToIntegral<int>(range.substr(0, sep))};
+        const auto last{sep == std::string::npos ? std::nullopt : ToIntegral<int>(range.substr(sep + 1))};
+        if (!first || !last || *first < 0 || *last < *first || *last == std::numeric_limits<int>::max()) {
+            return util::Error{strprintf(_("Invalid -prunepinrange '%s'. Expected <first>-<last> block heights."), range)};
+        }
+        opts.prune_pinned_ranges.emplace_back(*first, *last);
+    }
+
     if (auto value{args.GetBoolArg("-fastprune")}) opts.fast_prune = *value;
 
     ReadDatabaseArgs(args, opts.block_tree_db_params.options);
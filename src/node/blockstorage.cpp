@@ -16,6 +16,7 @@
 #include <kernel/messagestartchars.h>
 #include <kernel/notifications_interface.h>
 #include <logging.h>
+#include <node/blockcompression.h>
 #include <pow.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
@@ -35,13 +36,16 @@
 #include <util/signalinterrupt.h>
 #include <util/strencodings.h>
 #include <util/syserror.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <validation.h>
 
 #include <cstddef>
 #include <map>
 #include <optional>
+#include <set>
 #include <unordered_map>
+#include <utility>
 
 namespace kernel {
 static constexpr uint8_t DB_BLOCK_FILES{'f'};
@@ -272,6 +276,24 @@ void BlockManager::PruneOneBlockFile(const int fileNumber)
     m_dirty_fileinfo.insert(fileNumber);
 }
 
+void BlockManager::PruneOneUndoFile(const int fileNumber)
+{
+    AssertLockHeld(cs_main);
+    LOCK(cs_LastBlockFile);
+
+    for (auto& entry : m_block_index) {
+        CBlockIndex* pindex = &entry.second;
+        if (pindex->nFile == fileNumber && (pindex->nStatus & BLOCK_HAVE_UNDO)) {
+            pindex->nStatus &= ~BLOCK_HAVE_UNDO;
+            pindex->nUndoPos = 0;
+            m_dirty_blockindex.insert(pindex);
+        }
+    }
+
+    m_blockfile_info.at(fileNumber).nUndoSize = 0;
+    m_dirty_fileinfo.insert(fileNumber);
+}
+
 void BlockManager::FindFilesToPruneManual(
     std::set<int>& setFilesToPrune,
     int nManualPruneHeight,
@@ -293,6 +315,9 @@ void BlockManager::FindFilesToPruneManual(
         if (fileinfo.nSize == 0 || fileinfo.nHeightLast > (unsigned)last_block_can_prune || fileinfo.nHeightFirst < (unsigned)min_block_to_prune) {
             continue;
         }
+        if (IsPinnedByPruneLock(fileinfo)) {
+            continue;
+        }
 
         PruneOneBlockFile(fileNumber);
         setFilesToPrune.insert(fileNumber);
@@ -362,6 +387,11 @@ void BlockManager::FindFilesToPrune(
                 continue;
             }
 
+            // don't prune files holding a height range pinned by a prune lock.
+            if (IsPinnedByPruneLock(fileinfo)) {
+                continue;
+            }
+
             PruneOneBlockFile(fileNumber);
             // Queue up the files for removal
             setFilesToPrune.insert(fileNumber);
@@ -376,6 +406,59 @@ void BlockManager::FindFilesToPrune(
              min_block_to_prune, last_block_can_prune, count);
 }
 
+void BlockManager::FindUndoFilesToPrune(
+    std::set<int>& undo_files_to_prune,
+    int last_prune,
+    const Chainstate& chain,
+    ChainstateManager& chainman)
+{
+    const int keep_undo{static_cast<int>(GetPruneKeepUndoBlocks())};
+    if (keep_undo == 0) return;
+
+    LOCK2(cs_main, cs_LastBlockFile);
+    if (chain.m_chain.Height() < 0) {
+        return;
+    }
+
+    const auto [min_block_to_prune, last_block_can_prune] = chainman.GetPruneRange(chain, last_prune);
+    // Undo data is kept for a window that may be shorter than the one for
+    // block data, but never beyond what the prune locks allow.
+    const int last_undo_can_prune{std::min(last_prune, chain.m_chain.Height() - keep_undo)};
+    if (last_undo_can_prune <= 0) return;
+
+    int count = 0;
+    for (int fileNumber = 0; fileNumber < this->MaxBlockfileNum(); fileNumber++) {
+        const auto& fileinfo = m_blockfile_info[fileNumber];
+        if (fileinfo.nSize == 0 || fileinfo.nUndoSize == 0) {
+            continue;
+        }
+        if (fileinfo.nHeightLast > (unsigned)last_undo_can_prune || fileinfo.nHeightFirst < (unsigned)min_block_to_prune) {
+            continue;
+        }
+        if (IsPinnedByPruneLock(fileinfo)) {
+            continue;
+        }
+
+        PruneOneUndoFile(fileNumber);
+        undo_files_to_prune.insert(fileNumber);
+        count++;
+    }
+
+    LogDebug(BCLog::PRUNE, "[%s] max_undo_prune_height=%d removed %d rev files\n",
+             chain.GetRole(), last_undo_can_prune, count);
+}
+
+bool BlockManager::IsPinnedByPruneLock(const CBlockFileInfo& fileinfo) const
+{
+    AssertLockHeld(::cs_main);
+    for (const auto& [_, lock] : m_prune_locks) {
+        if (lock.IsRange() && fileinfo.nHeightFirst <= (unsigned)lock.height_last && fileinfo.nHeightLast >= (unsigned)lock.height_first) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void BlockManager::UpdatePruneLock(const std::string& name, const PruneLockInfo& lock_info) {
     AssertLockHeld(::cs_main);
     m_prune_locks[name] = lock_info;
@@ -695,14 +778,124 @@ bool BlockManager::ReadBlockUndo(CBlockUndo& blockundo, const CBlockIndex& index
 
 bool BlockManager::FlushUndoFile(int block_file, bool finalize)
 {
+    // Truncation happens right away, so that later undo writes to this file
+    // can never be cut off by a commit that is still queued.
     FlatFilePos undo_pos_old(block_file, m_blockfile_info[block_file].nUndoSize);
-    if (!m_undo_file_seq.Flush(undo_pos_old, finalize)) {
+    if (finalize && !m_undo_file_seq.Truncate(undo_pos_old)) {
         m_opts.notifications.flushError(_("Flushing undo file to disk failed. This is likely the result of an I/O error."));
         return false;
     }
+    ScheduleFileCommit(block_file, /*undo=*/true);
     return true;
 }
 
+uint64_t BlockManager::ScheduleFileCommit(int file_num, bool undo)
+{
+    uint64_t sequence;
+    {
+        LOCK(m_flush_mutex);
+        sequence = ++m_commit_seq_scheduled;
+        m_pending_commits.push_back({sequence, file_num, undo});
+    }
+    m_flush_cv.notify_all();
+    return sequence;
+}
+
+void BlockManager::ScheduleUnlinkPrunedFiles(const std::set<int>& files, const std::set<int>& undo_files)
+{
+    if (files.empty() && undo_files.empty()) return;
+    {
+        LOCK(m_flush_mutex);
+        ++m_unlink_seq_scheduled;
+        m_pending_unlinks.insert(files.begin(), files.end());
+        m_pending_undo_unlinks.insert(undo_files.begin(), undo_files.end());
+    }
+    m_flush_cv.notify_all();
+}
+
+bool BlockManager::WaitForFileCommit(uint64_t sequence)
+{
+    WAIT_LOCK(m_flush_mutex, lock);
+    m_flush_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_flush_mutex) { return m_commit_seq_done >= sequence; });
+    return !std::exchange(m_commit_failed, false);
+}
+
+bool BlockManager::WaitForFileOps()
+{
+    WAIT_LOCK(m_flush_mutex, lock);
+    const uint64_t commit_target{m_commit_seq_scheduled};
+    const uint64_t unlink_target{m_unlink_seq_scheduled};
+    m_flush_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_flush_mutex) {
+        return m_commit_seq_done >= commit_target && m_unlink_seq_done >= unlink_target;
+    });
+    return !std::exchange(m_commit_failed, false);
+}
+
+void BlockManager::ThreadFlushFiles()
+{
+    WAIT_LOCK(m_flush_mutex, lock);
+    while (true) {
+        m_flush_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_flush_mutex) {
+            return m_stop_flush_thread || !m_pending_commits.empty() || !m_pending_unlinks.empty() || !m_pending_undo_unlinks.empty();
+        });
+        // Pending operations are drained before stopping.
+        if (m_pending_commits.empty() && m_pending_unlinks.empty() && m_pending_undo_unlinks.empty()) return;
+
+        // While draining on shutdown the notifications may already be gone,
+        // so failures are only logged.
+        const bool stopping{m_stop_flush_thread};
+
+        // Group commit: everything queued so far is handled in one pass,
+        // with at most one fsync per file. Commits are published before the
+        // unlinks run, so waiting for a commit never waits for pruning.
+        if (!m_pending_commits.empty()) {
+            const std::vector<PendingFileCommit> batch{std::exchange(m_pending_commits, {})};
+            bool success{true};
+            {
+                REVERSE_LOCK(lock, m_flush_mutex);
+                std::set<std::pair<bool, int>> files;
+                for (const auto& commit : batch) {
+                    files.emplace(commit.undo, commit.file_num);
+                }
+                for (const auto& [undo, file_num] : files) {
+                    const FlatFileSeq& seq{undo ? m_undo_file_seq : m_block_file_seq};
+                    if (seq.Flush(FlatFilePos{file_num, 0})) continue;
+                    success = false;
+                    const bilingual_str message = undo ? _("Flushing undo file to disk failed. This is likely the result of an I/O error.") :
+                                                         _("Flushing block file to disk failed. This is likely the result of an I/O error.");
+                    if (stopping) {
+                        LogError("%s\n", message.original);
+                    } else {
+                        m_opts.notifications.flushError(message);
+                    }
+                }
+                LogDebug(BCLog::BLOCKSTORAGE, "Committed %d block/undo files for %d scheduled flushes (up to sequence %d)\n",
+                         files.size(), batch.size(), batch.back().sequence);
+            }
+            // Sequence numbers are assigned in queue order, so the last one
+            // covers the whole group.
+            m_commit_seq_done = batch.back().sequence;
+            if (!success) m_commit_failed = true;
+            m_flush_cv.notify_all();
+        }
+
+        if (!m_pending_unlinks.empty() || !m_pending_undo_unlinks.empty()) {
+            const std::set<int> unlinks{std::exchange(m_pending_unlinks, {})};
+            const std::set<int> undo_unlinks{std::exchange(m_pending_undo_unlinks, {})};
+            const uint64_t unlink_seq{m_unlink_seq_scheduled};
+            {
+                REVERSE_LOCK(lock, m_flush_mutex);
+                // Pruned files are never written to again, so unlinking
+                // them concurrently with later commits is safe.
+                UnlinkPrunedFiles(unlinks);
+                UnlinkPrunedUndoFiles(undo_unlinks);
+            }
+            m_unlink_seq_done = unlink_seq;
+            m_flush_cv.notify_all();
+        }
+    }
+}
+
 bool BlockManager::FlushBlockFile(int blockfile_num, bool fFinalize, bool finalize_undo)
 {
     bool success = true;
@@ -718,10 +911,11 @@ bool BlockManager::FlushBlockFile(int blockfile_num, bool fFinalize, bool finali
     assert(static_cast<int>(m_blockfile_info.size()) > blockfile_num);
 
     FlatFilePos block_pos_old(blockfile_num, m_blockfile_info[blockfile_num].nSize);
-    if (!m_block_file_seq.Flush(block_pos_old, fFinalize)) {
+    if (fFinalize && !m_block_file_seq.Truncate(block_pos_old)) {
         m_opts.notifications.flushError(_("Flushing block file to disk failed. This is likely the result of an I/O error."));
         success = false;
     }
+    ScheduleFileCommit(blockfile_num, /*undo=*/false);
     // we do not always flush the undo file, as the chain tip may be lagging behind the incoming blocks,
     // e.g. during IBD or a sync after a node going offline
     if (!fFinalize || finalize_undo) {
@@ -747,11 +941,16 @@ bool BlockManager::FlushChainstateBlockFile(int tip_height)
     // If the cursor does not exist, it means an assumeutxo snapshot is loaded,
     // but no blocks past the snapshot height have been written yet, so there
     // is no data associated with the chainstate, and it is safe not to flush.
-    if (cursor) {
-        return FlushBlockFile(cursor->file_num, /*fFinalize=*/false, /*finalize_undo=*/false);
-    }
-    // No need to log warnings in this case.
-    return true;
+    uint64_t sequence{WITH_LOCK(m_flush_mutex, return m_commit_seq_scheduled)};
+    if (cursor && !m_blockfile_info.empty()) {
+        ScheduleFileCommit(cursor->file_num, /*undo=*/false);
+        sequence = ScheduleFileCommit(cursor->file_num, /*undo=*/true);
+    }
+    // Commits complete in sequence order, so this also covers files that
+    // were finalized earlier: all block and undo data the block index and
+    // chainstate may refer to is durable once it returns. Pending unlinks
+    // of pruned files are not waited for.
+    return WaitForFileCommit(sequence);
 }
 
 uint64_t BlockManager::CalculateCurrentUsage()
@@ -778,6 +977,16 @@ void BlockManager::UnlinkPrunedFiles(const std::set<int>& setFilesToPrune) const
     }
 }
 
+void BlockManager::UnlinkPrunedUndoFiles(const std::set<int>& undo_files_to_prune) const
+{
+    std::error_code ec;
+    for (const int file_num : undo_files_to_prune) {
+        if (fs::remove(m_undo_file_seq.FileName(FlatFilePos{file_num, 0}), ec)) {
+            LogDebug(BCLog::BLOCKSTORAGE, "Prune: %s deleted rev (%05u)\n", __func__, file_num);
+        }
+    }
+}
+
 AutoFile BlockManager::OpenBlockFile(const FlatFilePos& pos, bool fReadOnly) const
 {
     return AutoFile{m_block_file_seq.Open(pos, fReadOnly), m_obfuscation};
@@ -884,7 +1093,7 @@ FlatFilePos BlockManager::FindNextBlockPos(unsigned int nAddSize, unsigned int n
     return pos;
 }
 
-void BlockManager::UpdateBlockInfo(const CBlock& block, unsigned int nHeight, const FlatFilePos& pos)
+void BlockManager::UpdateBlockInfo(const CBlock& block, unsigned int nHeight, const FlatFilePos& pos, unsigned int record_size)
 {
     LOCK(cs_LastBlockFile);
 
@@ -896,13 +1105,12 @@ void BlockManager::UpdateBlockInfo(const CBlock& block, unsigned int nHeight, co
     }
 
     // Update the file information with the current block.
-    const unsigned int added_size = ::GetSerializeSize(TX_WITH_WITNESS(block));
     const int nFile = pos.nFile;
     if (static_cast<int>(m_blockfile_info.size()) <= nFile) {
         m_blockfile_info.resize(nFile + 1);
     }
     m_blockfile_info[nFile].AddBlock(nHeight, block.GetBlockTime());
-    m_blockfile_info[nFile].nSize = std::max(pos.nPos + added_size, m_blockfile_info[nFile].nSize);
+    m_blockfile_info[nFile].nSize = std::max(pos.nPos + record_size, m_blockfile_info[nFile].nSize);
     m_dirty_fileinfo.insert(nFile);
 }
 
@@ -1071,6 +1279,9 @@ bool BlockManager::ReadRawBlock(std::vector<std::byte>& block, const FlatFilePos
             return false;
         }
 
+        const bool compressed{(blk_size & BLOCK_COMPRESSED_FLAG) != 0};
+        blk_size &= ~BLOCK_COMPRESSED_FLAG;
+
         if (blk_size > MAX_SIZE) {
             LogError("Block data is larger than maximum deserialization size for %s: %s versus %s while reading raw block",
                 pos.ToString(), blk_size, MAX_SIZE);
@@ -1079,6 +1290,15 @@ bool BlockManager::ReadRawBlock(std::vector<std::byte>& block, const FlatFilePos
 
         block.resize(blk_size); // Zeroing of memory is intentional here
         filein.read(block);
+
+        if (compressed) {
+            auto raw_block{DecompressBlock(block, MAX_SIZE)};
+            if (!raw_block) {
+                LogError("Malformed compressed block frame for %s while reading raw block", pos.ToString());
+                return false;
+            }
+            block = std::move(*raw_block);
+        }
     } catch (const std::exception& e) {
         LogError("Read from block file failed: %s for %s while reading raw block", e.what(), pos.ToString());
         return false;
@@ -1089,8 +1309,13 @@ bool BlockManager::ReadRawBlock(std::vector<std::byte>& block, const FlatFilePos
 
 FlatFilePos BlockManager::WriteBlock(const CBlock& block, int nHeight)
 {
-    const unsigned int block_size{static_cast<unsigned int>(GetSerializeSize(TX_WITH_WITNESS(block)))};
-    FlatFilePos pos{FindNextBlockPos(block_size + STORAGE_HEADER_BYTES, nHeight, block.GetBlockTime())};
+    std::optional<std::vector<std::byte>> frame;
+    if (m_opts.compress_blocks) {
+        frame = CompressBlock(block);
+    }
+    const unsigned int block_size{frame ? 0U : static_cast<unsigned int>(GetSerializeSize(TX_WITH_WITNESS(block)))};
+    const unsigned int record_size{frame ? static_cast<unsigned int>(frame->size()) : block_size};
+    FlatFilePos pos{FindNextBlockPos(record_size + STORAGE_HEADER_BYTES, nHeight, block.GetBlockTime())};
     if (pos.IsNull()) {
         LogError("FindNextBlockPos failed for %s while writing block", pos.ToString());
         return FlatFilePos();
@@ -1105,10 +1330,14 @@ FlatFilePos BlockManager::WriteBlock(const CBlock& block, int nHeight)
         BufferedWriter fileout{file};
 
         // Write index header
-        fileout << GetParams().MessageStart() << block_size;
+        fileout << GetParams().MessageStart() << (frame ? record_size | BLOCK_COMPRESSED_FLAG : block_size);
         pos.nPos += STORAGE_HEADER_BYTES;
         // Write block
-        fileout << TX_WITH_WITNESS(block);
+        if (frame) {
+            fileout.write(*frame);
+        } else {
+            fileout << TX_WITH_WITNESS(block);
+        }
     }
 
     if (file.fclose() != 0) {
@@ -1195,6 +1424,22 @@ BlockManager::BlockManager(const util::SignalInterrupt& interrupt, Options opts)
             CleanupBlockRevFiles();
         }
     }
+
+    if (!m_opts.prune_pinned_ranges.empty()) {
+        LOCK(::cs_main);
+        for (const auto& [first, last] : m_opts.prune_pinned_ranges) {
+            UpdatePruneLock(strprintf("pinned %d-%d", first, last), {.height_first = first, .height_last = last});
+        }
+    }
+
+    m_flush_thread = std::thread(&util::TraceThread, "blkflush", [this] { ThreadFlushFiles(); });
+}
+
+BlockManager::~BlockManager()
+{
+    WITH_LOCK(m_flush_mutex, m_stop_flush_thread = true);
+    m_flush_cv.notify_all();
+    if (m_flush_thread.joinable()) m_flush_thread.join();
 }
 
 class ImportingNow
@@ -1223,7 +1468,7 @@ void ImportBlocks(ChainstateManager& chainman, std::span<const fs::path> import_
         int nFile = 0;
         // Map of disk positions for blocks with unknown parent (only used for reindex);
         // parent hash -> child disk position, multiple children can have the same parent.
-        std::multimap<uint256, FlatFilePos> blocks_with_unknown_parent;
+        std::multimap<uint256, std::pair<FlatFilePos, unsigned int>> blocks_with_unknown_parent;
         while (true) {
             FlatFilePos pos(nFile, 0);
             if (!fs::exists(chainman.m_blockman.GetBlockPosFilename(pos))) {
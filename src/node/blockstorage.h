@@ -22,6 +22,7 @@
 
 #include <array>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <limits>
@@ -31,6 +32,7 @@
 #include <set>
 #include <span>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -97,6 +99,12 @@ struct CBlockIndexHeightOnlyComparator {
 
 struct PruneLockInfo {
     int height_first{std::numeric_limits<int>::max()}; //! Height of earliest block that should be kept and not pruned
+    //! Height of latest block that should be kept. When set, the lock only
+    //! pins the [height_first, height_last] range and blocks above it may
+    //! still be pruned.
+    int height_last{std::numeric_limits<int>::max()};
+
+    bool IsRange() const { return height_last != std::numeric_limits<int>::max(); }
 };
 
 enum BlockfileType {
@@ -151,12 +159,38 @@ private:
     bool LoadBlockIndex(const std::optional<uint256>& snapshot_blockhash)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    /** Return false if block file or undo file flushing fails. */
+    /**
+     * Truncate the block file (and optionally its undo file) if final, and
+     * schedule both to be committed to disk by the flush thread.
+     * Return false if block file or undo file truncation fails.
+     */
     [[nodiscard]] bool FlushBlockFile(int blockfile_num, bool fFinalize, bool finalize_undo);
 
-    /** Return false if undo file flushing fails. */
+    /**
+     * Truncate the undo file if final, and schedule it to be committed to
+     * disk by the flush thread. Return false if undo file truncation fails.
+     */
     [[nodiscard]] bool FlushUndoFile(int block_file, bool finalize = false);
 
+    /** A block or undo file commit (fsync) waiting for the flush thread. */
+    struct PendingFileCommit {
+        uint64_t sequence;
+        int file_num;
+        bool undo;
+    };
+
+    /**
+     * Queue removal of pruned files, so that unlinking does not stall the
+     * caller. Must only be called once the block index no longer refers to
+     * these files.
+     *
+     * @param[in] files       Files whose blk and rev parts are both removed
+     * @param[in] undo_files  Files of which only the rev part is removed
+     */
+    void ScheduleUnlinkPrunedFiles(const std::set<int>& files, const std::set<int>& undo_files) EXCLUSIVE_LOCKS_REQUIRED(!m_flush_mutex);
+
+    void ThreadFlushFiles() EXCLUSIVE_LOCKS_REQUIRED(!m_flush_mutex);
+
     /**
      * Helper function performing various preparations before a block can be saved to disk:
      * Returns the correct position for the block to be saved, which may be in the current or a new
@@ -201,6 +235,21 @@ private:
         const Chainstate& chain,
         ChainstateManager& chainman);
 
+    /**
+     * Select undo files (rev???.dat) to delete ahead of their block files when
+     * -prunekeepundo is set. Only files whose blocks are all deeper than
+     * -prunekeepundo, and within the allowable prune range, are selected.
+     * HAVE_UNDO is unset for the blocks stored in them; block data is kept.
+     *
+     * @param[out]   undo_files_to_prune  The set of file indices whose undo file can be unlinked
+     * @param        last_prune           The last height we're able to prune, according to the prune locks
+     */
+    void FindUndoFilesToPrune(
+        std::set<int>& undo_files_to_prune,
+        int last_prune,
+        const Chainstate& chain,
+        ChainstateManager& chainman);
+
     RecursiveMutex cs_LastBlockFile;
     std::vector<CBlockFileInfo> m_blockfile_info;
 
@@ -258,10 +307,29 @@ private:
     const FlatFileSeq m_block_file_seq;
     const FlatFileSeq m_undo_file_seq;
 
+    Mutex m_flush_mutex;
+    std::condition_variable m_flush_cv;
+    std::vector<PendingFileCommit> m_pending_commits GUARDED_BY(m_flush_mutex);
+    std::set<int> m_pending_unlinks GUARDED_BY(m_flush_mutex);
+    std::set<int> m_pending_undo_unlinks GUARDED_BY(m_flush_mutex);
+    //! Sequence number of the most recently scheduled commit
+    uint64_t m_commit_seq_scheduled GUARDED_BY(m_flush_mutex){0};
+    //! Every commit with a sequence number up to and including this one is durable
+    uint64_t m_commit_seq_done GUARDED_BY(m_flush_mutex){0};
+    //! Sequence number of the most recently scheduled batch of unlinks
+    uint64_t m_unlink_seq_scheduled GUARDED_BY(m_flush_mutex){0};
+    //! Every unlink batch up to and including this one is done
+    uint64_t m_unlink_seq_done GUARDED_BY(m_flush_mutex){0};
+    //! Whether a commit failed since the last wait for commits
+    bool m_commit_failed GUARDED_BY(m_flush_mutex){false};
+    bool m_stop_flush_thread GUARDED_BY(m_flush_mutex){false};
+    std::thread m_flush_thread;
+
 public:
     using Options = kernel::BlockManagerOpts;
 
     explicit BlockManager(const util::SignalInterrupt& interrupt, Options opts);
+    ~BlockManager();
 
     const util::SignalInterrupt& m_interrupt;
     std::atomic<bool> m_importing{false};
@@ -318,6 +386,9 @@ public:
     //! Mark one block file as pruned (modify associated database entries)
     void PruneOneBlockFile(const int fileNumber) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    //! Mark the undo data of one block file as pruned, keeping its block data
+    void PruneOneUndoFile(const int fileNumber) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     CBlockIndex* LookupBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     const CBlockIndex* LookupBlockIndex(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -342,14 +413,48 @@ public:
      * @param[in]  block        the block being processed
      * @param[in]  nHeight      the height of the block
      * @param[in]  pos          the position of the serialized CBlock on disk
+     * @param[in]  record_size  the size of the record stored at pos, excluding its header;
+     *                          smaller than the serialized block for compressed records
+     */
+    void UpdateBlockInfo(const CBlock& block, unsigned int nHeight, const FlatFilePos& pos, unsigned int record_size);
+
+    /**
+     * Queue a commit (fsync) of the given block or undo file. Commits are
+     * performed in groups by the flush thread, at most one fsync per file per
+     * group, and complete in the order of their sequence numbers.
+     *
+     * @returns the sequence number assigned to this commit.
+     */
+    uint64_t ScheduleFileCommit(int file_num, bool undo) EXCLUSIVE_LOCKS_REQUIRED(!m_flush_mutex);
+
+    /**
+     * Block until the commit with the given sequence number, and therefore
+     * every commit scheduled before it, is durable. Block data must be
+     * committed before the block index or the chainstate are written to
+     * point at it; waiting for the sequence number of the last commit
+     * covering that data enforces this without synchronous writes.
+     *
+     * @returns false if any commit failed since the previous wait.
+     */
+    [[nodiscard]] bool WaitForFileCommit(uint64_t sequence) EXCLUSIVE_LOCKS_REQUIRED(!m_flush_mutex);
+
+    /**
+     * Block until every commit and every unlink of pruned files scheduled so
+     * far is done.
+     *
+     * @returns false if any commit failed since the previous wait.
      */
-    void UpdateBlockInfo(const CBlock& block, unsigned int nHeight, const FlatFilePos& pos);
+    [[nodiscard]] bool WaitForFileOps() EXCLUSIVE_LOCKS_REQUIRED(!m_flush_mutex);
 
     /** Whether running in -prune mode. */
     [[nodiscard]] bool IsPruneMode() const { return m_prune_mode; }
 
     /** Attempt to stay below this number of bytes of block files. */
     [[nodiscard]] uint64_t GetPruneTarget() const { return m_opts.prune_target; }
+    /** Number of most recent blocks that are never pruned. MIN_BLOCKS_TO_KEEP applies if larger. */
+    [[nodiscard]] uint32_t GetPruneKeepBlocks() const { return m_opts.prune_keep_blocks; }
+    /** Number of most recent blocks whose undo data is kept, or 0 to prune undo data along with blocks. */
+    [[nodiscard]] uint32_t GetPruneKeepUndoBlocks() const { return m_opts.prune_keep_undo_blocks; }
     static constexpr auto PRUNE_TARGET_MANUAL{std::numeric_limits<uint64_t>::max()};
 
     [[nodiscard]] bool LoadingBlocks() const { return m_importing || !m_blockfiles_indexed; }
@@ -396,6 +501,9 @@ public:
     //! Check whether the block associated with this index entry is pruned or not.
     bool IsBlockPruned(const CBlockIndex& block) const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    //! Whether a prune lock pins a height range overlapping the given block file.
+    bool IsPinnedByPruneLock(const CBlockFileInfo& fileinfo) const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     //! Create or update a prune lock identified by its name
     void UpdatePruneLock(const std::string& name, const PruneLockInfo& lock_info) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
@@ -410,6 +518,11 @@ public:
      */
     void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune) const;
 
+    /**
+     *  Actually unlink the undo files of the specified file numbers
+     */
+    void UnlinkPrunedUndoFiles(const std::set<int>& undo_files_to_prune) const;
+
     /** Functions for disk access for blocks */
     bool ReadBlock(CBlock& block, const FlatFilePos& pos, const std::optional<uint256>& expected_hash) const;
     bool ReadBlock(CBlock& block, const CBlockIndex& index) const;
@@ -7,6 +7,9 @@
 #include <common/args.h>
 #include <dbwrapper.h>
 
+#include <algorithm>
+#include <cstdint>
+
 namespace node {
 void ReadDatabaseArgs(const ArgsManager& args, DBOptions& options)
 {
@@ -14,5 +17,6 @@ void ReadDatabaseArgs(const ArgsManager& args, DBOptions& options)
     // databases), but it'd be easy to parse database-specific options by adding
     // a database_type string or enum parameter to this function.
     if (auto value = args.GetBoolArg("-forcecompactdb")) options.force_compact = *value;
+    if (auto value = args.GetIntArg("-dbcompactionbudget")) options.compaction_budget = uint64_t(std::clamp<int64_t>(*value, 0, int64_t{1} << 30)) << 20;
 }
 } // namespace node
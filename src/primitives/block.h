@@ -87,9 +87,19 @@ public:
         *(static_cast<CBlockHeader*>(this)) = header;
     }
 
-    SERIALIZE_METHODS(CBlock, obj)
+    template <typename Stream>
+    void Serialize(Stream& s) const
     {
-        READWRITE(AsBase<CBlockHeader>(obj), obj.vtx);
+        s << AsBase<CBlockHeader>(*this) << vtx;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        // Compute all txids and wtxids of the block in one batch.
+        std::vector<CMutableTransaction> txs;
+        s >> AsBase<CBlockHeader>(*this) >> txs;
+        vtx = MakeTransactionRefs(std::move(txs));
     }
 
     void SetNull()
@@ -7,10 +7,12 @@
 
 #include <consensus/amount.h>
 #include <crypto/hex_base.h>
+#include <crypto/sha256.h>
 #include <hash.h>
 #include <primitives/transaction_identifier.h>
 #include <script/script.h>
 #include <serialize.h>
+#include <span.h>
 #include <tinyformat.h>
 #include <uint256.h>
 
@@ -94,6 +96,72 @@ Wtxid CTransaction::ComputeWitnessHash() const
 
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), version{tx.version}, nLockTime{tx.nLockTime}, m_has_witness{ComputeHasWitness()}, hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), version{tx.version}, nLockTime{tx.nLockTime}, m_has_witness{ComputeHasWitness()}, hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const Txid& txid, const Wtxid& wtxid, PrecomputedHashes) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), version{tx.version}, nLockTime{tx.nLockTime}, m_has_witness{ComputeHasWitness()}, hash{txid}, m_witness_hash{wtxid} {}
+
+namespace {
+/** Appends serialized objects to a byte vector. */
+class ByteVectorWriter
+{
+    std::vector<unsigned char>& m_data;
+
+public:
+    explicit ByteVectorWriter(std::vector<unsigned char>& data) : m_data{data} {}
+
+    void write(std::span<const std::byte> src)
+    {
+        m_data.insert(m_data.end(), UCharCast(src.data()), UCharCast(src.data() + src.size()));
+    }
+
+    template <typename T>
+    ByteVectorWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+};
+} // namespace
+
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs)
+{
+    // Serialize every transaction without, and if it has one with, its witness,
+    // so that all txids and wtxids can be hashed side by side.
+    std::vector<unsigned char> data;
+    std::vector<size_t> ends;
+    ends.reserve(txs.size() * 2);
+    ByteVectorWriter writer{data};
+    for (const auto& tx : txs) {
+        writer << TX_NO_WITNESS(tx);
+        ends.push_back(data.size());
+        if (tx.HasWitness()) {
+            writer << TX_WITH_WITNESS(tx);
+            ends.push_back(data.size());
+        }
+    }
+    std::vector<std::span<const unsigned char>> messages;
+    messages.reserve(ends.size());
+    size_t begin{0};
+    for (const size_t end : ends) {
+        messages.emplace_back(data.data() + begin, end - begin);
+        begin = end;
+    }
+    std::vector<unsigned char> hashes(messages.size() * CSHA256::OUTPUT_SIZE);
+    SHA256DMany(hashes.data(), messages);
+
+    std::vector<CTransactionRef> ret;
+    ret.reserve(txs.size());
+    std::span<const unsigned char> next_hash{hashes};
+    const auto take_hash{[&] {
+        const uint256 hash{next_hash.first(CSHA256::OUTPUT_SIZE)};
+        next_hash = next_hash.subspan(CSHA256::OUTPUT_SIZE);
+        return hash;
+    }};
+    for (auto& tx : txs) {
+        const Txid txid{Txid::FromUint256(take_hash())};
+        const Wtxid wtxid{Wtxid::FromUint256(tx.HasWitness() ? take_hash() : txid.ToUint256())};
+        ret.push_back(std::make_shared<const CTransaction>(std::move(tx), txid, wtxid, CTransaction::PrecomputedHashes{}));
+    }
+    return ret;
+}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -319,10 +319,18 @@ private:
 
     bool ComputeHasWitness() const;
 
+    /** Restricts construction from precomputed hashes to MakeTransactionRefs(). */
+    struct PrecomputedHashes {
+        explicit PrecomputedHashes() = default;
+    };
+    friend std::vector<std::shared_ptr<const CTransaction>> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
 public:
     /** Convert a CMutableTransaction into a CTransaction. */
     explicit CTransaction(const CMutableTransaction& tx);
     explicit CTransaction(CMutableTransaction&& tx);
+    /** Convert a CMutableTransaction whose hashes were already computed. */
+    CTransaction(CMutableTransaction&& tx, const Txid& txid, const Wtxid& wtxid, PrecomputedHashes);
 
     template <typename Stream>
     inline void Serialize(Stream& s) const {
@@ -423,4 +431,8 @@ struct CMutableTransaction
 typedef std::shared_ptr<const CTransaction> CTransactionRef;
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/** Convert a batch of transactions, such as those of a block, computing all of
+ *  their txids and wtxids in a single multi-buffer SHA256 pass. */
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
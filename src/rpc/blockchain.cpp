@@ -17,6 +17,7 @@
 #include <consensus/validation.h>
 #include <pol/pol.h>
 #include <core_io.h>
+#include <dbwrapper.h>
 #include <deploymentinfo.h>
 #include <deploymentstatus.h>
 #include <flatfile.h>
@@ -49,6 +50,7 @@
 #include <util/fs.h>
 #include <util/strencodings.h>
 #include <util/syserror.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <validation.h>
 #include <validationinterface.h>
@@ -3461,6 +3463,72 @@ return RPCHelpMan{
     };
 }
 
+static std::string WriteStallToString(DBWriteStall stall)
+{
+    switch (stall) {
+    case DBWriteStall::NONE: return "none";
+    case DBWriteStall::SLOWDOWN: return "slowdown";
+    case DBWriteStall::STOP: return "stop";
+    } // no default case, so the compiler can warn about missing cases
+    NONFATAL_UNREACHABLE();
+}
+
+static RPCHelpMan getcompactioninfo()
+{
+    return RPCHelpMan{
+        "getcompactioninfo",
+        "Return compaction statistics and the write-stall state of the active chainstate's coins database.\n",
+        {},
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+            {
+                {RPCResult::Type::NUM, "idle_compactions", "number of range compactions run between blocks"},
+                {RPCResult::Type::NUM, "idle_compaction_bytes", "bytes written by them"},
+                {RPCResult::Type::NUM, "idle_compaction_time", "seconds spent in them"},
+                {RPCResult::Type::NUM, "level0_files", "number of level-0 table files"},
+                {RPCResult::Type::STR, "write_stall", "whether writes are currently delayed (\"none\", \"slowdown\" or \"stop\")"},
+                {RPCResult::Type::ARR, "levels", "statistics of all compactions, per level", {
+                    {RPCResult::Type::OBJ, "", "", {
+                        {RPCResult::Type::NUM, "level", "the level"},
+                        {RPCResult::Type::NUM, "files", "number of table files"},
+                        {RPCResult::Type::NUM, "size_mib", "size of the table files"},
+                        {RPCResult::Type::NUM, "compaction_time", "seconds spent compacting into this level"},
+                        {RPCResult::Type::NUM, "read_mib", "data read by those compactions"},
+                        {RPCResult::Type::NUM, "write_mib", "data written by those compactions"},
+                    }},
+                }},
+            }},
+        RPCExamples{
+            HelpExampleCli("getcompactioninfo", "")
+            + HelpExampleRpc("getcompactioninfo", "")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    const DBCompactionStats stats{WITH_LOCK(::cs_main, return chainman.ActiveChainstate().CoinsDB().GetCompactionStats())};
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("idle_compactions", stats.idle_compactions);
+    obj.pushKV("idle_compaction_bytes", stats.idle_compaction_bytes);
+    obj.pushKV("idle_compaction_time", Ticks<SecondsDouble>(stats.idle_compaction_time));
+    obj.pushKV("level0_files", stats.level0_files);
+    obj.pushKV("write_stall", WriteStallToString(stats.write_stall));
+    UniValue levels(UniValue::VARR);
+    for (const auto& level : stats.levels) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("level", level.level);
+        entry.pushKV("files", level.files);
+        entry.pushKV("size_mib", level.size_mib);
+        entry.pushKV("compaction_time", level.compaction_seconds);
+        entry.pushKV("read_mib", level.read_mib);
+        entry.pushKV("write_mib", level.write_mib);
+        levels.push_back(std::move(entry));
+    }
+    obj.pushKV("levels", std::move(levels));
+    return obj;
+},
+    };
+}
 
 static RPCHelpMan getpolmineridstatus()
 {
@@ -3564,6 +3632,7 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &dumptxoutset},
         {"blockchain", &loadtxoutset},
         {"blockchain", &getchainstates},
+        {"blockchain", &getcompactioninfo},
         {"blockchain", &getpolmineridstatus},
         {"hidden", &invalidateblock},
         {"hidden", &reconsiderblock},
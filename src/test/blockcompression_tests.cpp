@@ -0,0 +1,106 @@
+// Copyright (c) 2026-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <consensus/consensus.h>
+#include <node/blockcompression.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <vector>
+
+using node::CompressBlock;
+using node::DecompressBlock;
+
+namespace {
+CBlock CreateRepetitiveBlock(FastRandomContext& rng, int num_txs)
+{
+    CBlock block;
+    block.nVersion = 0x20000000;
+    block.hashPrevBlock = rng.rand256();
+    block.hashMerkleRoot = rng.rand256();
+    for (int i{0}; i < num_txs; ++i) {
+        CMutableTransaction mtx;
+        mtx.version = 2;
+        mtx.vin.emplace_back(COutPoint{Txid::FromUint256(rng.rand256()), 0});
+        mtx.vin[0].scriptWitness.stack.push_back(rng.randbytes(71));
+        mtx.vin[0].scriptWitness.stack.push_back(rng.randbytes(33));
+        for (int j{0}; j < 2; ++j) {
+            mtx.vout.emplace_back(rng.randrange(100'000'000), CScript() << OP_0 << rng.randbytes(20));
+        }
+        block.vtx.push_back(MakeTransactionRef(mtx));
+    }
+    return block;
+}
+
+std::vector<std::byte> Serialize(const CBlock& block)
+{
+    DataStream stream;
+    stream << TX_WITH_WITNESS(block);
+    return {stream.begin(), stream.end()};
+}
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockcompression_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(roundtrip)
+{
+    const CBlock block{CreateRepetitiveBlock(m_rng, 200)};
+    const auto raw{Serialize(block)};
+    const auto frame{CompressBlock(raw)};
+    BOOST_REQUIRE(frame);
+    BOOST_CHECK_LT(frame->size(), raw.size());
+    // Compressing the block directly yields the same frame.
+    BOOST_CHECK(CompressBlock(block) == frame);
+
+    const auto decompressed{DecompressBlock(*frame, MAX_BLOCK_SERIALIZED_SIZE)};
+    BOOST_REQUIRE(decompressed);
+    BOOST_CHECK(*decompressed == raw);
+
+    // Long runs exercise the extended literal and match length encodings.
+    std::vector<std::byte> runs(100'000, std::byte{0x42});
+    const auto random_tail{m_rng.randbytes<std::byte>(1000)};
+    runs.insert(runs.end(), random_tail.begin(), random_tail.end());
+    const auto runs_frame{CompressBlock(runs)};
+    BOOST_REQUIRE(runs_frame);
+    BOOST_CHECK(DecompressBlock(*runs_frame, runs.size()) == runs);
+}
+
+BOOST_AUTO_TEST_CASE(incompressible)
+{
+    // Random data does not shrink, so the caller is told to store it raw.
+    BOOST_CHECK(!CompressBlock(m_rng.randbytes<std::byte>(10'000)));
+    BOOST_CHECK(!CompressBlock(std::vector<std::byte>{}));
+}
+
+BOOST_AUTO_TEST_CASE(malformed_frames)
+{
+    const auto raw{Serialize(CreateRepetitiveBlock(m_rng, 50))};
+    const auto frame{CompressBlock(raw)};
+    BOOST_REQUIRE(frame);
+
+    // Uncompressed size above the caller's limit.
+    BOOST_CHECK(!DecompressBlock(*frame, raw.size() - 1));
+    // Missing frame header.
+    BOOST_CHECK(!DecompressBlock(std::span{*frame}.first(2), MAX_BLOCK_SERIALIZED_SIZE));
+    // Every truncation must be rejected rather than produce a short block.
+    for (size_t len{node::BLOCK_COMPRESSED_FRAME_HEADER_BYTES}; len < frame->size(); len += 7) {
+        BOOST_CHECK(!DecompressBlock(std::span{*frame}.first(len), MAX_BLOCK_SERIALIZED_SIZE));
+    }
+    // Random corruption must never crash or overrun, only fail or yield a
+    // block of the advertised size.
+    for (int i{0}; i < 100; ++i) {
+        auto corrupt{*frame};
+        corrupt[node::BLOCK_COMPRESSED_FRAME_HEADER_BYTES + m_rng.randrange(corrupt.size() - node::BLOCK_COMPRESSED_FRAME_HEADER_BYTES)] = std::byte(m_rng.randbits(8));
+        const auto result{DecompressBlock(corrupt, MAX_BLOCK_SERIALIZED_SIZE)};
+        if (result) BOOST_CHECK_EQUAL(result->size(), raw.size());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
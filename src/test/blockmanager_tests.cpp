@@ -2,26 +2,75 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <addresstype.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <clientversion.h>
+#include <kernel/notifications_interface.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <node/kernel_notifications.h>
 #include <script/solver.h>
 #include <primitives/block.h>
+#include <sync.h>
+#include <undo.h>
 #include <util/chaintype.h>
+#include <util/translation.h>
 #include <validation.h>
 
 #include <boost/test/unit_test.hpp>
 #include <test/util/logging.h>
 #include <test/util/setup_common.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <vector>
+
 using node::STORAGE_HEADER_BYTES;
 using node::BlockManager;
 using node::KernelNotifications;
 using node::MAX_BLOCKFILE_SIZE;
 
+namespace {
+//! Manual pruning with a retention policy: keep the last 990 blocks, undo
+//! data for the last 985 and everything at height 5.
+struct PruneRetentionSetup : public TestingSetup {
+    PruneRetentionSetup()
+        : TestingSetup{ChainType::MAIN, {.extra_args = {"-prune=1", "-fastprune", "-prunekeepblocks=990", "-prunekeepundo=985", "-prunepinrange=5-5"}}} {}
+};
+
+//! Counts flush errors, and can hold the flush thread inside flushError().
+class FlushErrorNotifications : public kernel::Notifications
+{
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    int m_errors GUARDED_BY(m_mutex){0};
+    bool m_hold GUARDED_BY(m_mutex){false};
+
+public:
+    void flushError(const bilingual_str& message) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        ++m_errors;
+        m_cv.notify_all();
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !m_hold; });
+    }
+
+    void Hold(bool hold) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WITH_LOCK(m_mutex, m_hold = hold);
+        m_cv.notify_all();
+    }
+
+    int WaitForErrors(int count) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_errors >= count; });
+        return m_errors;
+    }
+};
+} // namespace
+
 // use BasicTestingSetup here for the data directory configuration, setup, and cleanup
 BOOST_FIXTURE_TEST_SUITE(blockmanager_tests, BasicTestingSetup)
 
@@ -46,7 +95,7 @@ BOOST_AUTO_TEST_CASE(blockmanager_find_block_pos)
     // the block is found at offset 8 because there is an 8 byte serialization header
     // consisting of 4 magic bytes + 4 length bytes before each block in a well-formed blk file.
     const FlatFilePos pos{0, STORAGE_HEADER_BYTES};
-    blockman.UpdateBlockInfo(params->GenesisBlock(), 0, pos);
+    blockman.UpdateBlockInfo(params->GenesisBlock(), 0, pos, ::GetSerializeSize(TX_WITH_WITNESS(params->GenesisBlock())));
     // now simulate what happens after reindex for the first new block processed
     // the actual block contents don't matter, just that it's a block.
     // verify that the write position is at offset 0x12d.
@@ -211,7 +260,7 @@ BOOST_AUTO_TEST_CASE(blockmanager_flush_block_file)
     // to block 2 location.
     CBlockFileInfo* block_data = blockman.GetBlockFileInfo(0);
     BOOST_CHECK_EQUAL(block_data->nBlocks, 2);
-    blockman.UpdateBlockInfo(block3, /*nHeight=*/3, /*pos=*/pos2);
+    blockman.UpdateBlockInfo(block3, /*nHeight=*/3, /*pos=*/pos2, /*record_size=*/TEST_BLOCK_SIZE);
     // Metadata is updated...
     BOOST_CHECK_EQUAL(block_data->nBlocks, 3);
     // ...but there are still only two blocks in the file
@@ -222,4 +271,252 @@ BOOST_AUTO_TEST_CASE(blockmanager_flush_block_file)
     BOOST_CHECK_EQUAL(read_block.nVersion, 2);
 }
 
+BOOST_AUTO_TEST_CASE(blockmanager_file_commit_groups)
+{
+    FlushErrorNotifications notifications;
+    node::BlockManager::Options blockman_opts{
+        .chainparams = Params(),
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+        .block_tree_db_params = DBParams{
+            .path = m_args.GetDataDirNet() / "blocks" / "index",
+            .cache_bytes = 0,
+        },
+    };
+    BlockManager blockman{*Assert(m_node.shutdown_signal), blockman_opts};
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(CMutableTransaction{}));
+    BOOST_CHECK_EQUAL(blockman.WriteBlock(block, /*nHeight=*/0).nFile, 0);
+    // A directory in place of a block file makes its commit fail.
+    BOOST_REQUIRE(fs::create_directories(blockman.GetBlockPosFilename(FlatFilePos{99, 0})));
+
+    // Keep the flush thread busy with a failing commit.
+    notifications.Hold(true);
+    const uint64_t failing_seq{blockman.ScheduleFileCommit(99, /*undo=*/false)};
+    BOOST_CHECK_EQUAL(notifications.WaitForErrors(1), 1);
+
+    uint64_t last_seq{0};
+    {
+        // Commits queued in the meantime form a single group, with one fsync per file.
+        ASSERT_DEBUG_LOG("Committed 1 block/undo files for 5 scheduled flushes");
+        for (int i{0}; i < 5; ++i) {
+            last_seq = blockman.ScheduleFileCommit(0, /*undo=*/false);
+        }
+        BOOST_CHECK_EQUAL(last_seq, failing_seq + 5);
+        notifications.Hold(false);
+        // Waiting for the last commit also waits for the earlier failing
+        // one, whose failure is reported exactly once.
+        BOOST_CHECK(!blockman.WaitForFileCommit(last_seq));
+    }
+    BOOST_CHECK(blockman.WaitForFileCommit(last_seq));
+    BOOST_CHECK(blockman.WaitForFileOps());
+    BOOST_CHECK_EQUAL(notifications.WaitForErrors(1), 1);
+
+    // A later failure is reported again.
+    BOOST_CHECK(!blockman.WaitForFileCommit(blockman.ScheduleFileCommit(99, /*undo=*/false)));
+    BOOST_CHECK_EQUAL(notifications.WaitForErrors(2), 2);
+    BOOST_CHECK(blockman.WaitForFileOps());
+}
+
+BOOST_AUTO_TEST_CASE(blockmanager_async_file_commits)
+{
+    KernelNotifications notifications{Assert(m_node.shutdown_request), m_node.exit_status, *Assert(m_node.warnings)};
+    node::BlockManager::Options blockman_opts{
+        .chainparams = Params(),
+        .fast_prune = true,
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+        .block_tree_db_params = DBParams{
+            .path = m_args.GetDataDirNet() / "blocks" / "index",
+            .cache_bytes = 0,
+        },
+    };
+    BlockManager blockman{*Assert(m_node.shutdown_signal), blockman_opts};
+
+    // Nothing scheduled yet.
+    BOOST_CHECK(blockman.WaitForFileOps());
+
+    // Fill the first (64kiB in -fastprune mode) block file until the next block
+    // has to go into a new file, which finalizes the first one.
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(CMutableTransaction{}));
+    FlatFilePos pos{blockman.WriteBlock(block, /*nHeight=*/1)};
+    int height{2};
+    while (pos.nFile == 0) {
+        pos = blockman.WriteBlock(block, height++);
+    }
+    BOOST_CHECK_EQUAL(pos.nFile, 1);
+
+    // The finalized file is truncated right away, its commit may still be pending.
+    const auto expected_size{blockman.GetBlockFileInfo(0)->nSize};
+    BOOST_CHECK_EQUAL(fs::file_size(blockman.GetBlockPosFilename(FlatFilePos{0, 0})), expected_size);
+    BOOST_CHECK(blockman.WaitForFileOps());
+}
+
+BOOST_AUTO_TEST_CASE(blockmanager_prune_lock_ranges)
+{
+    KernelNotifications notifications{Assert(m_node.shutdown_request), m_node.exit_status, *Assert(m_node.warnings)};
+    node::BlockManager::Options blockman_opts{
+        .chainparams = Params(),
+        .fast_prune = true,
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+        .block_tree_db_params = DBParams{
+            .path = m_args.GetDataDirNet() / "blocks" / "index",
+            .cache_bytes = 0,
+        },
+    };
+    BlockManager blockman{*Assert(m_node.shutdown_signal), blockman_opts};
+
+    // Spread blocks over three files.
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(CMutableTransaction{}));
+    int height{0};
+    while (blockman.WriteBlock(block, height).nFile < 2) ++height;
+    const CBlockFileInfo file0{*blockman.GetBlockFileInfo(0)};
+    const CBlockFileInfo file1{*blockman.GetBlockFileInfo(1)};
+    BOOST_CHECK(blockman.WaitForFileOps());
+
+    LOCK(::cs_main);
+    BOOST_CHECK(!blockman.IsPinnedByPruneLock(file0));
+
+    // A plain prune lock is enforced through the prune height, not per file.
+    blockman.UpdatePruneLock("index", {.height_first = 0});
+    BOOST_CHECK(!blockman.IsPinnedByPruneLock(file0));
+
+    // A range lock only pins the files overlapping its range.
+    blockman.UpdatePruneLock("range", {.height_first = static_cast<int>(file1.nHeightFirst), .height_last = static_cast<int>(file1.nHeightFirst)});
+    BOOST_CHECK(!blockman.IsPinnedByPruneLock(file0));
+    BOOST_CHECK(blockman.IsPinnedByPruneLock(file1));
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_prune_retention_policy, PruneRetentionSetup)
+{
+    auto& chainman{*Assert(m_node.chainman)};
+    auto& blockman{chainman.m_blockman};
+    Chainstate& chainstate{chainman.ActiveChainstate()};
+    constexpr int CHAIN_HEIGHT{1000};
+    constexpr int STORED_BLOCKS{30};
+
+    // Blocks of about 20kB, so a few fit into each (64kiB in -fastprune mode) block file.
+    CMutableTransaction mtx;
+    mtx.vout.emplace_back(0, CScript() << std::vector<unsigned char>(20'000));
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(mtx));
+
+    LOCK(::cs_main);
+    CBlockIndex* const genesis{chainstate.m_chain.Tip()};
+    std::vector<CBlockIndex*> indexes{genesis};
+    std::vector<int> block_files{0};
+    for (int height{1}; height <= CHAIN_HEIGHT; ++height) {
+        CBlockHeader header;
+        header.hashPrevBlock = indexes.back()->GetBlockHash();
+        header.nTime = indexes.back()->nTime + 1;
+        header.nBits = indexes.back()->nBits;
+        header.nNonce = height;
+        CBlockIndex* pindex{blockman.AddToBlockIndex(header, chainman.m_best_header)};
+        if (height <= STORED_BLOCKS) {
+            const FlatFilePos pos{blockman.WriteBlock(block, height)};
+            BOOST_REQUIRE(!pos.IsNull());
+            pindex->nFile = pos.nFile;
+            pindex->nDataPos = pos.nPos;
+            pindex->nStatus |= BLOCK_HAVE_DATA;
+            BlockValidationState state;
+            BOOST_REQUIRE(blockman.WriteBlockUndo(CBlockUndo{}, state, *pindex));
+            block_files.push_back(pos.nFile);
+        }
+        indexes.push_back(pindex);
+    }
+    chainstate.m_chain.SetTip(*indexes.back());
+
+    // Classify the finalized block files according to the policy.
+    const int last_file{block_files.back()};
+    std::vector<int> pruned, undo_pruned, kept;
+    for (int file{0}; file < last_file; ++file) {
+        const CBlockFileInfo info{*blockman.GetBlockFileInfo(file)};
+        BOOST_REQUIRE(info.nUndoSize > 0);
+        const bool pinned{info.nHeightFirst <= 5 && info.nHeightLast >= 5};
+        if (!pinned && info.nHeightLast <= CHAIN_HEIGHT - 990) {
+            pruned.push_back(file);
+        } else if (!pinned && info.nHeightLast <= CHAIN_HEIGHT - 985) {
+            undo_pruned.push_back(file);
+        } else {
+            kept.push_back(file);
+        }
+    }
+    BOOST_REQUIRE(!pruned.empty() && !undo_pruned.empty() && !kept.empty());
+
+    PruneBlockFilesManual(chainstate, CHAIN_HEIGHT);
+
+    // PruneBlockFilesManual() waits for the background unlinks.
+    const auto rev_path{[&](int file) { return m_args.GetBlocksDirPath() / fs::u8path(strprintf("rev%05u.dat", file)); }};
+    for (const int file : pruned) {
+        BOOST_CHECK(!fs::exists(blockman.GetBlockPosFilename(FlatFilePos{file, 0})));
+        BOOST_CHECK(!fs::exists(rev_path(file)));
+        BOOST_CHECK_EQUAL(blockman.GetBlockFileInfo(file)->nSize, 0U);
+    }
+    for (const int file : undo_pruned) {
+        BOOST_CHECK(fs::exists(blockman.GetBlockPosFilename(FlatFilePos{file, 0})));
+        BOOST_CHECK(!fs::exists(rev_path(file)));
+        BOOST_CHECK_EQUAL(blockman.GetBlockFileInfo(file)->nUndoSize, 0U);
+    }
+    for (const int file : kept) {
+        BOOST_CHECK(fs::exists(blockman.GetBlockPosFilename(FlatFilePos{file, 0})));
+        BOOST_CHECK(fs::exists(rev_path(file)));
+    }
+    for (int height{1}; height <= STORED_BLOCKS; ++height) {
+        const CBlockIndex& index{*indexes[height]};
+        const int file{block_files[height]};
+        if (file >= last_file) continue;
+        const bool file_pruned{std::ranges::find(pruned, file) != pruned.end()};
+        const bool undo_file_pruned{std::ranges::find(undo_pruned, file) != undo_pruned.end()};
+        BOOST_CHECK_EQUAL(bool(index.nStatus & BLOCK_HAVE_DATA), !file_pruned);
+        BOOST_CHECK_EQUAL(bool(index.nStatus & BLOCK_HAVE_UNDO), !file_pruned && !undo_file_pruned);
+    }
+
+    chainstate.m_chain.SetTip(*genesis);
+}
+
+BOOST_AUTO_TEST_CASE(blockmanager_compressed_blocks)
+{
+    KernelNotifications notifications{Assert(m_node.shutdown_request), m_node.exit_status, *Assert(m_node.warnings)};
+    node::BlockManager::Options blockman_opts{
+        .chainparams = Params(),
+        .compress_blocks = true,
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+        .block_tree_db_params = DBParams{
+            .path = m_args.GetDataDirNet() / "blocks" / "index",
+            .cache_bytes = 0,
+        },
+    };
+    BlockManager blockman{*Assert(m_node.shutdown_signal), blockman_opts};
+
+    // A block of similar P2WPKH spends compresses well.
+    CBlock big_block;
+    for (int i{0}; i < 100; ++i) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(COutPoint{Txid::FromUint256(m_rng.rand256()), 0});
+        mtx.vout.emplace_back(i, GetScriptForDestination(WitnessV0KeyHash{uint160{}}));
+        big_block.vtx.push_back(MakeTransactionRef(mtx));
+    }
+    // A block without transactions is too small to benefit and is stored raw.
+    CBlock small_block;
+    small_block.nVersion = 4;
+
+    const auto big_size{::GetSerializeSize(TX_WITH_WITNESS(big_block))};
+    const FlatFilePos big_pos{blockman.WriteBlock(big_block, /*nHeight=*/1)};
+    const FlatFilePos small_pos{blockman.WriteBlock(small_block, /*nHeight=*/2)};
+    BOOST_CHECK_LT(blockman.CalculateCurrentUsage(), big_size);
+
+    for (const auto& [block, pos] : {std::pair{&big_block, big_pos}, std::pair{&small_block, small_pos}}) {
+        DataStream expected;
+        expected << TX_WITH_WITNESS(*block);
+        std::vector<std::byte> raw;
+        BOOST_REQUIRE(blockman.ReadRawBlock(raw, pos));
+        BOOST_CHECK(std::ranges::equal(raw, expected));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -300,6 +300,41 @@ BOOST_FIXTURE_TEST_CASE(coins_cache_dbbase_simulation_test, CacheTest)
     SimulationTest(&db_base, true);
 }
 
+BOOST_AUTO_TEST_CASE(coins_db_cursor)
+{
+    // Use an on-disk database with a small write buffer, so the scan reads
+    // from table files, and enough coins to span several cursor batches.
+    CCoinsViewDB db{{.path = m_args.GetDataDirBase() / "coins_db_cursor", .cache_bytes = 1 << 16}, {}};
+    std::map<COutPoint, Coin> expected;
+    {
+        CCoinsViewCache cache{&db};
+        for (int i{0}; i < 2500; ++i) {
+            const COutPoint outpoint{Txid::FromUint256(m_rng.rand256()), uint32_t(m_rng.randrange(4))};
+            Coin coin{CTxOut{int64_t(m_rng.randrange(1000)), CScript() << i}, /*nHeightIn=*/i, /*fCoinBaseIn=*/false};
+            expected.emplace(outpoint, coin);
+            cache.AddCoin(outpoint, std::move(coin), /*possible_overwrite=*/false);
+        }
+        cache.SetBestBlock(m_rng.rand256());
+        cache.Flush();
+    }
+
+    size_t found{0};
+    COutPoint outpoint;
+    Coin coin;
+    std::unique_ptr<CCoinsViewCursor> cursor{db.Cursor()};
+    for (; cursor->Valid(); cursor->Next()) {
+        BOOST_REQUIRE(cursor->GetKey(outpoint));
+        BOOST_REQUIRE(cursor->GetValue(coin));
+        const auto it{expected.find(outpoint)};
+        BOOST_REQUIRE(it != expected.end());
+        BOOST_CHECK(coin.out == it->second.out);
+        BOOST_CHECK_EQUAL(coin.nHeight, it->second.nHeight);
+        ++found;
+    }
+    BOOST_CHECK(!cursor->GetKey(outpoint));
+    BOOST_CHECK_EQUAL(found, expected.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_FIXTURE_TEST_SUITE(coins_tests, BasicTestingSetup)
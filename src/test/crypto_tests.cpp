@@ -1086,6 +1086,34 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256dmany)
+{
+    // Messages of every length around the padding boundaries, in both the
+    // standard and (if supported) the multi-buffer implementation.
+    std::vector<std::vector<unsigned char>> msgs;
+    for (int len = 0; len <= 200; ++len) {
+        msgs.push_back(m_rng.randbytes<unsigned char>(len));
+    }
+    msgs.push_back(m_rng.randbytes<unsigned char>(5000));
+    std::vector<unsigned char> expected(32 * msgs.size());
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        CHash256().Write(msgs[i]).Finalize({expected.data() + 32 * i, 32});
+    }
+    for (const auto impl : {sha256_implementation::STANDARD, sha256_implementation::USE_SSE4_AND_AVX2, sha256_implementation::USE_ALL}) {
+        SHA256AutoDetect(impl);
+        for (size_t count : {size_t{0}, size_t{1}, size_t{3}, size_t{8}, size_t{13}, msgs.size()}) {
+            std::vector<std::span<const unsigned char>> inputs;
+            for (size_t i = 0; i < count; ++i) inputs.emplace_back(msgs[(i * 37) % msgs.size()]);
+            std::vector<unsigned char> out(32 * count);
+            SHA256DMany(out.data(), inputs);
+            for (size_t i = 0; i < count; ++i) {
+                BOOST_CHECK(memcmp(out.data() + 32 * i, expected.data() + 32 * ((i * 37) % msgs.size()), 32) == 0);
+            }
+        }
+    }
+    SHA256AutoDetect();
+}
+
 void CryptoTest::TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
@@ -7,6 +7,7 @@
 #include <test/util/setup_common.h>
 #include <uint256.h>
 #include <util/string.h>
+#include <util/time.h>
 
 #include <memory>
 #include <ranges>
@@ -409,6 +410,40 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(idle_compaction)
+{
+    // A small cache makes every batch below spill into level-0 table files.
+    CDBWrapper dbw({.path = m_args.GetDataDirBase() / "idle_compaction", .cache_bytes = 1 << 16, .options = {.compaction_budget = 1 << 30}});
+    const auto write_batch{[&] {
+        CDBBatch batch{dbw};
+        for (int i{0}; i < 200; ++i) {
+            batch.Write(std::make_pair(uint8_t{'C'}, m_rng.rand256()), m_rng.rand256());
+        }
+        BOOST_REQUIRE(dbw.WriteBatch(batch));
+    }};
+    for (int i{0}; i < 100 && dbw.GetCompactionStats().level0_files == 0; ++i) {
+        write_batch();
+        UninterruptibleSleep(10ms);
+    }
+    BOOST_REQUIRE_GT(dbw.GetCompactionStats().level0_files, 0);
+    BOOST_CHECK(dbw.GetWriteStall() == DBWriteStall::NONE);
+
+    dbw.RequestIdleCompaction(uint8_t{'C'});
+    for (int i{0}; i < 1000 && (dbw.GetCompactionStats().idle_compactions == 0 || dbw.GetCompactionStats().level0_files > 0); ++i) {
+        UninterruptibleSleep(10ms);
+    }
+    const DBCompactionStats stats{dbw.GetCompactionStats()};
+    BOOST_CHECK_GT(stats.idle_compactions, 0U);
+    BOOST_CHECK_EQUAL(stats.level0_files, 0);
+    BOOST_CHECK(!stats.levels.empty());
+
+    // Without a budget, no compactions are scheduled.
+    CDBWrapper disabled({.path = m_args.GetDataDirBase() / "idle_compaction_disabled", .cache_bytes = 1 << 16, .options = {.compaction_budget = 0}});
+    disabled.Write(std::make_pair(uint8_t{'C'}, uint256::ONE), uint256::ONE);
+    disabled.RequestIdleCompaction(uint8_t{'C'});
+    BOOST_CHECK_EQUAL(disabled.GetCompactionStats().idle_compactions, 0U);
+}
+
 BOOST_AUTO_TEST_CASE(unicodepath)
 {
     // Attempt to create a database with a UTF8 character in the path.
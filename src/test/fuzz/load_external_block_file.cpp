@@ -37,7 +37,7 @@ FUZZ_TARGET(load_external_block_file, .init = initialize_load_external_block_fil
     if (fuzzed_data_provider.ConsumeBool()) {
         // Corresponds to the -reindex case (track orphan blocks across files).
         FlatFilePos flat_file_pos;
-        std::multimap<uint256, FlatFilePos> blocks_with_unknown_parent;
+        std::multimap<uint256, std::pair<FlatFilePos, unsigned int>> blocks_with_unknown_parent;
         g_setup->m_node.chainman->LoadExternalBlockFile(fuzzed_block_file, &flat_file_pos, &blocks_with_unknown_parent);
     } else {
         // Corresponds to the -loadblock= case (orphan blocks aren't tracked across files).
@@ -126,6 +126,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getchaintips",
     "getchainstates",
     "getchaintxstats",
+    "getcompactioninfo",
     "getconnectioncount",
     "getdeploymentinfo",
     "getdescriptoractivity",
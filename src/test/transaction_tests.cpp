@@ -780,6 +780,27 @@ BOOST_AUTO_TEST_CASE(test_witness)
     CheckWithFlag(output1, input1, STANDARD_SCRIPT_VERIFY_FLAGS, true);
 }
 
+BOOST_AUTO_TEST_CASE(make_transaction_refs)
+{
+    std::vector<CMutableTransaction> txs(20);
+    for (size_t i = 0; i < txs.size(); ++i) {
+        txs[i].vin.emplace_back(Txid::FromUint256(m_rng.rand256()), i);
+        txs[i].vin[0].scriptSig = CScript() << m_rng.randbytes(i * 7);
+        if (i % 2) txs[i].vin[0].scriptWitness.stack.push_back(m_rng.randbytes(i * 11));
+        txs[i].vout.emplace_back(i * COIN, CScript() << OP_TRUE);
+    }
+    std::vector<CTransactionRef> expected;
+    for (const auto& tx : txs) expected.push_back(MakeTransactionRef(tx));
+
+    const std::vector<CTransactionRef> refs{MakeTransactionRefs(std::move(txs))};
+    BOOST_REQUIRE_EQUAL(refs.size(), expected.size());
+    for (size_t i = 0; i < refs.size(); ++i) {
+        BOOST_CHECK_EQUAL(refs[i]->GetHash(), expected[i]->GetHash());
+        BOOST_CHECK_EQUAL(refs[i]->GetWitnessHash(), expected[i]->GetWitnessHash());
+        BOOST_CHECK_EQUAL(refs[i]->HasWitness(), expected[i]->HasWitness());
+    }
+}
+
 BOOST_AUTO_TEST_CASE(test_IsStandard)
 {
     FillableSigningProvider keystore;
@@ -3,8 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <checkqueue.h>
 #include <consensus/amount.h>
 #include <consensus/merkle.h>
+#include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
 #include <net.h>
@@ -360,4 +362,58 @@ BOOST_AUTO_TEST_CASE(block_malleation)
     }
 }
 
+BOOST_AUTO_TEST_CASE(parallel_check_block)
+{
+    CCheckQueue<CBlockTxCheck> queue{/*batch_size=*/1, /*worker_threads_num=*/2};
+    const auto& consensus{Params().GetConsensus()};
+
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << OP_0 << OP_0;
+    coinbase.vout.emplace_back(0, CScript() << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    for (size_t i = 0; i < PARALLEL_BLOCK_CHECK_MIN_TXS + 200; ++i) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(Txid::FromUint256(m_rng.rand256()), 0);
+        tx.vin[0].scriptSig = CScript() << OP_CHECKSIG;
+        tx.vout.emplace_back(1, CScript() << OP_TRUE);
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+
+    BlockValidationState state;
+    BOOST_CHECK(CheckBlock(block, state, consensus, /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/true, &queue));
+    BOOST_CHECK(state.IsValid());
+
+    // Too many legacy sigops are found across the ranges checked by the workers.
+    CBlock sigops_block{block};
+    for (size_t i = 1; i < sigops_block.vtx.size(); ++i) {
+        CMutableTransaction tx{*sigops_block.vtx[i]};
+        tx.vin[0].scriptSig = CScript() << OP_CHECKMULTISIG << OP_CHECKMULTISIG;
+        sigops_block.vtx[i] = MakeTransactionRef(tx);
+    }
+    sigops_block.hashMerkleRoot = BlockMerkleRoot(sigops_block);
+    state = {};
+    BOOST_CHECK(!CheckBlock(sigops_block, state, consensus, /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/true, &queue));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-blk-sigops");
+
+    // The first invalid transaction in block order is reported, as without a queue.
+    for (const size_t bad : {size_t{900}, size_t{300}}) {
+        CMutableTransaction tx{*block.vtx[bad]};
+        tx.vin.push_back(tx.vin[0]);
+        block.vtx[bad] = MakeTransactionRef(tx);
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    BlockValidationState serial_state;
+    BOOST_CHECK(!CheckBlock(block, serial_state, consensus, /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/true));
+    block.fChecked = false;
+    block.m_checked_merkle_root = false;
+    state = {};
+    BOOST_CHECK(!CheckBlock(block, state, consensus, /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/true, &queue));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-inputs-duplicate");
+    BOOST_CHECK_EQUAL(state.GetDebugMessage(), serial_state.GetDebugMessage());
+    BOOST_CHECK(state.GetDebugMessage().find(block.vtx[300]->GetHash().ToString()) != std::string::npos);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -17,7 +17,9 @@
 #include <cassert>
 #include <cstdlib>
 #include <iterator>
+#include <optional>
 #include <utility>
+#include <vector>
 
 static constexpr uint8_t DB_COIN{'C'};
 static constexpr uint8_t DB_BEST_BLOCK{'B'};
@@ -159,6 +161,11 @@ size_t CCoinsViewDB::EstimateSize() const
     return m_db->EstimateSize(DB_COIN, uint8_t(DB_COIN + 1));
 }
 
+void CCoinsViewDB::RequestIdleCompaction()
+{
+    m_db->RequestIdleCompaction(DB_COIN);
+}
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
@@ -176,8 +183,16 @@ public:
     void Next() override;
 
 private:
+    //! Number of coins decoded from the database at a time.
+    static constexpr size_t BATCH_SIZE{1024};
+
+    //! Decode the next batch of coins, stopping at the first non-coin record.
+    void FillBatch();
+
     std::unique_ptr<CDBIterator> pcursor;
-    std::pair<char, COutPoint> keyTmp;
+    //! Decoded coins; the value is missing if it failed to deserialize.
+    std::vector<std::pair<COutPoint, std::optional<Coin>>> m_batch;
+    size_t m_batch_pos{0};
 
     friend class CCoinsViewDB;
 };
@@ -185,49 +200,50 @@ private:
 std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
 {
     auto i = std::make_unique<CCoinsViewDBCursor>(
-        const_cast<CDBWrapper&>(*m_db).NewIterator(), GetBestBlock());
+        const_cast<CDBWrapper&>(*m_db).NewScanIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
-    // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
-    } else {
-        i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
-    }
+    i->FillBatch();
     return i;
 }
 
-bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
+void CCoinsViewDBCursor::FillBatch()
 {
-    // Return cached key
-    if (keyTmp.first == DB_COIN) {
-        key = keyTmp.second;
-        return true;
+    m_batch.clear();
+    m_batch_pos = 0;
+    COutPoint outpoint;
+    CoinEntry entry(&outpoint);
+    while (m_batch.size() < BATCH_SIZE && pcursor->Valid() && pcursor->GetKey(entry) && entry.key == DB_COIN) {
+        auto& coin{m_batch.emplace_back(outpoint, Coin{}).second};
+        if (!pcursor->GetValue(*coin)) coin.reset();
+        pcursor->Next();
     }
-    return false;
+}
+
+bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
+{
+    if (!Valid()) return false;
+    key = m_batch[m_batch_pos].first;
+    return true;
 }
 
 bool CCoinsViewDBCursor::GetValue(Coin &coin) const
 {
-    return pcursor->GetValue(coin);
+    if (!Valid() || !m_batch[m_batch_pos].second) return false;
+    coin = *m_batch[m_batch_pos].second;
+    return true;
 }
 
 bool CCoinsViewDBCursor::Valid() const
 {
-    return keyTmp.first == DB_COIN;
+    return m_batch_pos < m_batch.size();
 }
 
 void CCoinsViewDBCursor::Next()
 {
-    pcursor->Next();
-    CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
-        keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
-    } else {
-        keyTmp.first = entry.key;
+    if (++m_batch_pos == m_batch.size() && m_batch.size() == BATCH_SIZE) {
+        FillBatch();
     }
 }
@@ -59,6 +59,11 @@ public:
 
     //! @returns filesystem path to on-disk storage or std::nullopt if in memory.
     std::optional<fs::path> StoragePath() { return m_db->StoragePath(); }
+
+    //! Compact the coins key range in the background while the caller is idle.
+    void RequestIdleCompaction() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    DBCompactionStats GetCompactionStats() const EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return m_db->GetCompactionStats(); }
 };
 
 #endif // BITCOIN_TXDB_H
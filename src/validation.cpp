@@ -30,6 +30,7 @@
 #include <kernel/warning.h>
 #include <logging.h>
 #include <logging/timer.h>
+#include <node/blockcompression.h>
 #include <node/blockstorage.h>
 #include <node/utxo_snapshot.h>
 #include <policy/ephemeral_policy.h>
@@ -2854,6 +2855,7 @@ bool Chainstate::FlushStateToDisk(
     LOCK(cs_main);
     assert(this->CanFlushToDisk());
     std::set<int> setFilesToPrune;
+    std::set<int> undo_files_to_prune;
     bool full_flush_completed = false;
 
     const size_t coins_count = CoinsTip().GetCacheSize();
@@ -2873,6 +2875,8 @@ bool Chainstate::FlushStateToDisk(
 
             for (const auto& prune_lock : m_blockman.m_prune_locks) {
                 if (prune_lock.second.height_first == std::numeric_limits<int>::max()) continue;
+                // Pinned ranges are checked per block file instead of capping the prune height.
+                if (prune_lock.second.IsRange()) continue;
                 // Remove the buffer and one additional block here to get actual height that is outside of the buffer
                 const int lock_height{prune_lock.second.height_first - PRUNE_LOCK_BUFFER - 1};
                 last_prune = std::max(1, std::min(last_prune, lock_height));
@@ -2898,6 +2902,10 @@ bool Chainstate::FlushStateToDisk(
                 m_blockman.FindFilesToPrune(setFilesToPrune, last_prune, *this, m_chainman);
                 m_blockman.m_check_for_pruning = false;
             }
+            m_blockman.FindUndoFilesToPrune(undo_files_to_prune, last_prune, *this, m_chainman);
+            if (!undo_files_to_prune.empty()) {
+                fFlushForPrune = true;
+            }
             if (!setFilesToPrune.empty()) {
                 fFlushForPrune = true;
                 if (!m_blockman.m_have_pruned) {
@@ -2943,11 +2951,10 @@ bool Chainstate::FlushStateToDisk(
                     return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to block index database."));
                 }
             }
-            // Finally remove any pruned files
+            // Finally remove any pruned files. This happens on the block
+            // storage flush thread, off the validation thread.
             if (fFlushForPrune) {
-                LOG_TIME_MILLIS_WITH_CATEGORY("unlink pruned files", BCLog::BENCH);
-
-                m_blockman.UnlinkPrunedFiles(setFilesToPrune);
+                m_blockman.ScheduleUnlinkPrunedFiles(setFilesToPrune, undo_files_to_prune);
             }
 
             if (!CoinsTip().GetBestBlock().IsNull()) {
@@ -3115,6 +3122,7 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
         const int max_height_first{pindexDelete->nHeight - 1};
         for (auto& prune_lock : m_blockman.m_prune_locks) {
             if (prune_lock.second.height_first <= max_height_first) continue;
+            if (prune_lock.second.IsRange()) continue;
 
             prune_lock.second.height_first = max_height_first;
             LogDebug(BCLog::PRUNE, "%s prune lock moved back to %d\n", prune_lock.first, max_height_first);
@@ -3660,6 +3668,13 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
         return false;
     }
 
+    // Use the time until the next block to compact the coins database, so
+    // that the next flush does not stall on a compaction.
+    {
+        LOCK(::cs_main);
+        if (!m_chainman.IsInitialBlockDownload()) CoinsDB().RequestIdleCompaction();
+    }
+
     return true;
 }
 
@@ -4092,7 +4107,17 @@ static bool CheckWitnessMalleation(const CBlock& block, bool expect_witness_comm
     return true;
 }
 
-bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
+std::optional<std::string> CBlockTxCheck::operator()()
+{
+    for (const auto& tx : m_txs) {
+        TxValidationState tx_state;
+        if (!CheckTransaction(*tx, tx_state)) return tx_state.GetRejectReason();
+        *m_sigops += GetLegacySigOpCount(*tx);
+    }
+    return std::nullopt;
+}
+
+bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, CCheckQueue<CBlockTxCheck>* check_queue)
 {
     // These are checks that are independent of context.
 
@@ -4109,6 +4134,25 @@ bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensu
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-signet-blksig", "signet block signature validation failure");
     }
 
+    // For large blocks, start the context-free transaction checks on the
+    // worker threads while the checks below that take precedence over them,
+    // including the merkle root, are done here. The transactions are split
+    // into a few ranges per worker.
+    std::vector<unsigned int> range_sigops; // outlives control, whose destructor waits for the workers
+    std::optional<CCheckQueueControl<CBlockTxCheck>> control;
+    if (check_queue && check_queue->HasThreads() && block.vtx.size() >= PARALLEL_BLOCK_CHECK_MIN_TXS) {
+        const std::span<const CTransactionRef> txs{block.vtx};
+        const size_t range_size{std::max<size_t>(txs.size() / (MAX_SCRIPTCHECK_THREADS * 4), 64)};
+        range_sigops.resize((txs.size() + range_size - 1) / range_size);
+        std::vector<CBlockTxCheck> checks;
+        checks.reserve(range_sigops.size());
+        for (size_t i = 0; i < range_sigops.size(); ++i) {
+            checks.emplace_back(txs.subspan(i * range_size, std::min(range_size, txs.size() - i * range_size)), range_sigops[i]);
+        }
+        control.emplace(*check_queue);
+        control->Add(std::move(checks));
+    }
+
     // Check the merkle root.
     if (fCheckMerkleRoot && !CheckMerkleRoot(block, state)) {
         return false;
@@ -4133,22 +4177,29 @@ bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensu
 
     // Check transactions
     // Must check for duplicate inputs (see CVE-2018-17144)
-    for (const auto& tx : block.vtx) {
-        TxValidationState tx_state;
-        if (!CheckTransaction(*tx, tx_state)) {
-            // CheckBlock() does context-free validation checks. The only
-            // possible failures are consensus failures.
-            assert(tx_state.GetResult() == TxValidationResult::TX_CONSENSUS);
-            return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, tx_state.GetRejectReason(),
-                                 strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), tx_state.GetDebugMessage()));
-        }
-    }
     // This underestimates the number of sigops, because unlike ConnectBlock it
     // does not count witness and p2sh sigops.
     unsigned int nSigOps = 0;
-    for (const auto& tx : block.vtx)
-    {
-        nSigOps += GetLegacySigOpCount(*tx);
+    bool checked_in_parallel{false};
+    if (control && !control->Complete().has_value()) {
+        nSigOps = std::accumulate(range_sigops.begin(), range_sigops.end(), 0U);
+        checked_in_parallel = true;
+    }
+    if (!checked_in_parallel) {
+        // Also reports the first failure in block order if a parallel check failed.
+        for (const auto& tx : block.vtx) {
+            TxValidationState tx_state;
+            if (!CheckTransaction(*tx, tx_state)) {
+                // CheckBlock() does context-free validation checks. The only
+                // possible failures are consensus failures.
+                assert(tx_state.GetResult() == TxValidationResult::TX_CONSENSUS);
+                return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, tx_state.GetRejectReason(),
+                                     strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), tx_state.GetDebugMessage()));
+            }
+        }
+        for (const auto& tx : block.vtx) {
+            nSigOps += GetLegacySigOpCount(*tx);
+        }
     }
     if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-blk-sigops", "out-of-bounds SigOpCount");
@@ -4475,7 +4526,7 @@ void ChainstateManager::ReportHeadersPresync(const arith_uint256& work, int64_t
 }
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
-bool ChainstateManager::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked)
+bool ChainstateManager::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked, std::optional<unsigned int> dbp_record_size)
 {
     const CBlock& block = *pblock;
 
@@ -4527,7 +4578,7 @@ bool ChainstateManager::AcceptBlock(const std::shared_ptr<const CBlock>& pblock,
 
     const CChainParams& params{GetParams()};
 
-    if (!CheckBlock(block, state, params.GetConsensus()) ||
+    if (!CheckBlock(block, state, params.GetConsensus(), /*fCheckPOW=*/true, /*fCheckMerkleRoot=*/true, &m_block_check_queue) ||
         !ContextualCheckBlock(block, state, *this, pindex->pprev)) {
         if (Assume(state.IsInvalid())) {
             ActiveChainstate().InvalidBlockFound(pindex, state);
@@ -4548,7 +4599,8 @@ bool ChainstateManager::AcceptBlock(const std::shared_ptr<const CBlock>& pblock,
         FlatFilePos blockPos{};
         if (dbp) {
             blockPos = *dbp;
-            m_blockman.UpdateBlockInfo(block, pindex->nHeight, blockPos);
+            m_blockman.UpdateBlockInfo(block, pindex->nHeight, blockPos,
+                                       dbp_record_size.value_or(::GetSerializeSize(TX_WITH_WITNESS(block))));
         } else {
             blockPos = m_blockman.WriteBlock(block, pindex->nHeight);
             if (blockPos.IsNull()) {
@@ -4593,7 +4645,7 @@ bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& blo
         // malleability that cause CheckBlock() to fail; see e.g. CVE-2012-2459 and
         // https://lists.linuxfoundation.org/pipermail/bitcoin-dev/2019-February/016697.html.  Because CheckBlock() is
         // not very expensive, the anti-DoS benefits of caching failure (of a definitely-invalid block) are not substantial.
-        bool ret = CheckBlock(*block, state, GetConsensus());
+        bool ret = CheckBlock(*block, state, GetConsensus(), /*fCheckPOW=*/true, /*fCheckMerkleRoot=*/true, &m_block_check_queue);
         if (ret) {
             // Store to disk
             ret = AcceptBlock(block, state, &pindex, force_processing, nullptr, new_block, min_pow_checked);
@@ -4721,6 +4773,11 @@ void PruneBlockFilesManual(Chainstate& active_chainstate, int nManualPruneHeight
             state, FlushStateMode::NONE, nManualPruneHeight)) {
         LogPrintf("%s: failed to flush state (%s)\n", __func__, state.ToString());
     }
+    // Manual pruning is requested by the user; make sure the files are gone
+    // when this returns.
+    if (!active_chainstate.m_blockman.WaitForFileOps()) {
+        LogPrintf("%s: failed to flush block files\n", __func__);
+    }
 }
 
 bool Chainstate::LoadChainTip()
@@ -5105,7 +5162,7 @@ bool Chainstate::LoadGenesisBlock()
 void ChainstateManager::LoadExternalBlockFile(
     AutoFile& file_in,
     FlatFilePos* dbp,
-    std::multimap<uint256, FlatFilePos>* blocks_with_unknown_parent)
+    std::multimap<uint256, std::pair<FlatFilePos, unsigned int>>* blocks_with_unknown_parent)
 {
     // Either both should be specified (-reindex), or neither (-loadblock).
     assert(!dbp == !blocks_with_unknown_parent);
@@ -5126,6 +5183,7 @@ void ChainstateManager::LoadExternalBlockFile(
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
             unsigned int nSize = 0;
+            bool compressed{false};
             try {
                 // locate a header
                 MessageStartChars buf;
@@ -5137,7 +5195,9 @@ void ChainstateManager::LoadExternalBlockFile(
                 }
                 // read size
                 blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                compressed = (nSize & node::BLOCK_COMPRESSED_FLAG) != 0;
+                nSize &= ~node::BLOCK_COMPRESSED_FLAG;
+                if (nSize < (compressed ? node::BLOCK_COMPRESSED_FRAME_HEADER_BYTES : 80) || nSize > MAX_BLOCK_SERIALIZED_SIZE)
                     continue;
             } catch (const std::exception&) {
                 // no valid block header found; don't complain
@@ -5150,8 +5210,25 @@ void ChainstateManager::LoadExternalBlockFile(
                 if (dbp)
                     dbp->nPos = nBlockPos;
                 blkdat.SetLimit(nBlockPos + nSize);
+                // Compressed records are decompressed up front; the block is
+                // then read from memory instead of from the file.
+                std::vector<std::byte> raw_block;
+                if (compressed) {
+                    std::vector<std::byte> frame(nSize);
+                    blkdat.read(frame);
+                    auto decompressed{node::DecompressBlock(frame, MAX_BLOCK_SERIALIZED_SIZE)};
+                    if (!decompressed) {
+                        LogDebug(BCLog::REINDEX, "%s: Malformed compressed block frame at %d\n", __func__, nBlockPos);
+                        continue;
+                    }
+                    raw_block = std::move(*decompressed);
+                }
                 CBlockHeader header;
-                blkdat >> header;
+                if (compressed) {
+                    SpanReader{raw_block} >> header;
+                } else {
+                    blkdat >> header;
+                }
                 const uint256 hash{header.GetHash()};
                 // Skip the rest of this block (this may read from disk into memory); position to the marker before the
                 // next block, but it's still possible to rewind to the start of the current block (without a disk read).
@@ -5167,7 +5244,7 @@ void ChainstateManager::LoadExternalBlockFile(
                         LogDebug(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
                                  header.hashPrevBlock.ToString());
                         if (dbp && blocks_with_unknown_parent) {
-                            blocks_with_unknown_parent->emplace(header.hashPrevBlock, *dbp);
+                            blocks_with_unknown_parent->emplace(header.hashPrevBlock, std::make_pair(*dbp, nSize));
                         }
                         continue;
                     }
@@ -5176,13 +5253,17 @@ void ChainstateManager::LoadExternalBlockFile(
                     const CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
                     if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
                         // This block can be processed immediately; rewind to its start, read and deserialize it.
-                        blkdat.SetPos(nBlockPos);
                         pblock = std::make_shared<CBlock>();
-                        blkdat >> TX_WITH_WITNESS(*pblock);
-                        nRewind = blkdat.GetPos();
+                        if (compressed) {
+                            SpanReader{raw_block} >> TX_WITH_WITNESS(*pblock);
+                        } else {
+                            blkdat.SetPos(nBlockPos);
+                            blkdat >> TX_WITH_WITNESS(*pblock);
+                            nRewind = blkdat.GetPos();
+                        }
 
                         BlockValidationState state;
-                        if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr, true)) {
+                        if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr, true, nSize)) {
                             nLoaded++;
                         }
                         if (state.IsError()) {
@@ -5241,14 +5322,15 @@ void ChainstateManager::LoadExternalBlockFile(
                     queue.pop_front();
                     auto range = blocks_with_unknown_parent->equal_range(head);
                     while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+                        auto it = range.first;
+                        const auto& [child_pos, child_size] = it->second;
                         std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (m_blockman.ReadBlock(*pblockrecursive, it->second, {})) {
+                        if (m_blockman.ReadBlock(*pblockrecursive, child_pos, {})) {
                             const auto& block_hash{pblockrecursive->GetHash()};
                             LogDebug(BCLog::REINDEX, "%s: Processing out of order child %s of %s", __func__, block_hash.ToString(), head.ToString());
                             LOCK(cs_main);
                             BlockValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &it->second, nullptr, true)) {
+                            if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &child_pos, nullptr, true, child_size)) {
                                 nLoaded++;
                                 queue.push_back(block_hash);
                             }
@@ -6349,6 +6431,7 @@ static ChainstateManager::Options&& Flatten(ChainstateManager::Options&& opts)
 
 ChainstateManager::ChainstateManager(const util::SignalInterrupt& interrupt, Options options, node::BlockManager::Options blockman_options)
     : m_script_check_queue{/*batch_size=*/128, std::clamp(options.worker_threads_num, 0, MAX_SCRIPTCHECK_THREADS)},
+      m_block_check_queue{/*batch_size=*/1, std::clamp(options.worker_threads_num, 0, MAX_SCRIPTCHECK_THREADS), "Block transaction checks", "blkcheck"},
       m_interrupt{interrupt},
       m_options{Flatten(std::move(options))},
       m_blockman{interrupt, std::move(blockman_options)},
@@ -6611,10 +6694,11 @@ std::pair<int, int> ChainstateManager::GetPruneRange(const Chainstate& chainstat
         prune_start = *Assert(GetSnapshotBaseHeight()) + 1;
     }
 
+    const int blocks_to_keep{static_cast<int>(std::max<uint32_t>(MIN_BLOCKS_TO_KEEP, m_blockman.GetPruneKeepBlocks()))};
     int max_prune = std::max<int>(
-        0, chainstate.m_chain.Height() - static_cast<int>(MIN_BLOCKS_TO_KEEP));
+        0, chainstate.m_chain.Height() - blocks_to_keep);
 
-    // last block to prune is the lesser of (caller-specified height, MIN_BLOCKS_TO_KEEP from the tip)
+    // last block to prune is the lesser of (caller-specified height, blocks_to_keep from the tip)
     //
     // While you might be tempted to prune the background chainstate more
     // aggressively (i.e. fewer MIN_BLOCKS_TO_KEEP), this won't work with index
@@ -358,6 +358,24 @@ static_assert(std::is_nothrow_move_assignable_v<CScriptCheck>);
 static_assert(std::is_nothrow_move_constructible_v<CScriptCheck>);
 static_assert(std::is_nothrow_destructible_v<CScriptCheck>);
 
+/**
+ * Closure representing the context-free checks (CheckTransaction() and legacy
+ * sigop counting) of a range of a block's transactions, so that CheckBlock()
+ * can spread them over worker threads.
+ */
+class CBlockTxCheck
+{
+private:
+    std::span<const CTransactionRef> m_txs;
+    unsigned int* m_sigops;
+
+public:
+    CBlockTxCheck(std::span<const CTransactionRef> txs, unsigned int& sigops) : m_txs{txs}, m_sigops{&sigops} {}
+
+    //! Return the reject reason of a failing transaction, if any.
+    std::optional<std::string> operator()();
+};
+
 /**
  * Convenience class for initializing and passing the script execution cache
  * and signature cache.
@@ -383,8 +401,15 @@ public:
 
 /** Functions for validating blocks and updating the block tree */
 
-/** Context-independent validity checks */
-bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
+/** Blocks with at least this many transactions have their transactions checked in parallel by CheckBlock() */
+static constexpr size_t PARALLEL_BLOCK_CHECK_MIN_TXS{1000};
+
+/** Context-independent validity checks
+ *
+ * @param[in]   check_queue  If given, the transactions of large blocks are
+ *                           checked on its worker threads.
+ */
+bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, CCheckQueue<CBlockTxCheck>* check_queue = nullptr);
 
 /**
  * Verify a block, including transactions.
@@ -979,6 +1004,10 @@ private:
     //! A queue for script verifications that have to be performed by worker threads.
     CCheckQueue<CScriptCheck> m_script_check_queue;
 
+    //! A queue for the context-free transaction checks of large blocks, with
+    //! as many worker threads as the script verification queue.
+    CCheckQueue<CBlockTxCheck> m_block_check_queue;
+
     //! Timers and counters used for benchmarking validation in both background
     //! and active chainstates.
     SteadyClock::duration GUARDED_BY(::cs_main) time_check{};
@@ -1177,7 +1206,7 @@ public:
      * Because a block's parent may be in a later file, not just later in the same file, the
      * blocks_with_unknown_parent map must be passed in and out with each call. It's a multimap,
      * rather than just a map, because multiple blocks may have the same parent (when chain splits
-     * or stale blocks exist). It maps from parent-hash to child-disk-position.
+     * or stale blocks exist). It maps from parent-hash to child-disk-position and record size.
      *
      * This function can also be used to read blocks from user-specified block files using the
      * -loadblock= option. There's no unknown-parent tracking, so the last two arguments are omitted.
@@ -1185,14 +1214,14 @@ public:
      *
      * @param[in]     file_in                       File containing blocks to read
      * @param[in]     dbp                           (optional) Disk block position (only for reindex)
-     * @param[in,out] blocks_with_unknown_parent    (optional) Map of disk positions for blocks with
+     * @param[in,out] blocks_with_unknown_parent    (optional) Map of disk positions and record sizes for blocks with
      *                                              unknown parent, key is parent block hash
      *                                              (only used for reindex)
      * */
     void LoadExternalBlockFile(
         AutoFile& file_in,
         FlatFilePos* dbp = nullptr,
-        std::multimap<uint256, FlatFilePos>* blocks_with_unknown_parent = nullptr);
+        std::multimap<uint256, std::pair<FlatFilePos, unsigned int>>* blocks_with_unknown_parent = nullptr);
 
     /**
      * Process an incoming block. This only returns after the best known valid
@@ -1242,6 +1271,10 @@ public:
      *                              peer.
      * @param[in]   dbp             The location on disk, if we are importing
      *                              this block from prior storage.
+     * @param[in]   dbp_record_size The size of the record at dbp, excluding its
+     *                              header. Defaults to the serialized block
+     *                              size, which is only correct for uncompressed
+     *                              records.
      * @param[in]   min_pow_checked True if proof-of-work anti-DoS checks have
      *                              been done by caller for headers chain
      *
@@ -1253,7 +1286,7 @@ public:
      *
      * @returns   False if the block or header is invalid, or if saving to disk fails (likely a fatal error); true otherwise.
      */
-    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked, std::optional<unsigned int> dbp_record_size = std::nullopt) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     void ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const FlatFilePos& pos) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -1336,6 +1369,7 @@ public:
     void RecalculateBestHeader() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     CCheckQueue<CScriptCheck>& GetCheckQueue() { return m_script_check_queue; }
+    CCheckQueue<CBlockTxCheck>& GetBlockCheckQueue() { return m_block_check_queue; }
 
     ~ChainstateManager();
 };